@@ -13,6 +13,7 @@
 #include "alignment.h"
 #include "nclextra/myreader.h"
 #include <numeric>
+#include <sys/stat.h>
 #include <sstream>
 #include "model/rategamma.h"
 #include "gsl/mygsl.h"
@@ -531,9 +532,15 @@ Alignment::Alignment(char *filename, char *sequence_type, InputType &intype, str
     double readStart = getRealTime();
     cout << "Reading alignment file " << filename << " ... ";
     intype = detectInputFile(filename);
+    string cache_file = string(filename) + ".alncache";
+    bool use_cache = Params::getInstance().aln_cache && intype != IN_NEXUS && intype != IN_COUNTS;
+    bool cache_loaded = false;
 
     try {
-        if (intype == IN_NEXUS) {
+        if (use_cache && readAlignmentCache(cache_file.c_str(), filename)) {
+            cout << "loaded from binary cache " << cache_file << endl;
+            cache_loaded = true;
+        } else if (intype == IN_NEXUS) {
             cout << "Nexus format detected" << endl;
             readNexus(filename);
         } else if (intype == IN_FASTA) {
@@ -564,6 +571,8 @@ Alignment::Alignment(char *filename, char *sequence_type, InputType &intype, str
     } catch (string str) {
         outError(str);
     }
+    if (use_cache && !cache_loaded)
+        writeAlignmentCache(cache_file.c_str(), filename);
     if (verbose_mode >= VB_MED) {
         cout << "Time to read input file was " << (getRealTime() - readStart) << " sec." << endl;
     }
@@ -1259,6 +1268,7 @@ void Alignment::ungroupSitePattern()
 		site_pattern[i] = i;
 	}
 	pattern_index.clear();
+	buildPackedStates();
 }
 
 void Alignment::regroupSitePattern(int groups, IntVector& site_group)
@@ -1284,6 +1294,7 @@ void Alignment::regroupSitePattern(int groups, IntVector& site_group)
 		count += it->frequency;
 	ASSERT(count == getNSite());
 	pattern_index.clear();
+	buildPackedStates();
 	//printPhylip("/dev/stdout");
 }
 
@@ -1293,45 +1304,79 @@ void Alignment::regroupSitePattern(int groups, IntVector& site_group)
 	@param sequences vector of strings
 	@return the data type of the input sequences
 */
+/**
+    count the occurrences of each character over all sequences
+    @param sequences vector of strings
+    @param[out] char_count array of NUM_CHAR counts
+*/
+void countCharacters(StrVector &sequences, size_t *char_count) {
+    memset(char_count, 0, NUM_CHAR*sizeof(size_t));
+    size_t sequenceCount = sequences.size();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        size_t local_count[NUM_CHAR];
+        memset(local_count, 0, NUM_CHAR*sizeof(size_t));
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (size_t seqNum = 0; seqNum < sequenceCount; ++seqNum) {
+            auto start = sequences.at(seqNum).data();
+            auto stop  = start + sequences.at(seqNum).size();
+            for (auto i = start; i!=stop; ++i)
+                ++local_count[(unsigned char)(*i)];
+        }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        for (int c = 0; c < NUM_CHAR; c++)
+            char_count[c] += local_count[c];
+    }
+}
+
 SeqType Alignment::detectSequenceType(StrVector &sequences) {
+    double detectStart = getRealTime();
+    size_t char_count[NUM_CHAR];
+    countCharacters(sequences, char_count);
+    SeqType type = detectSequenceType(char_count);
+    if (verbose_mode >= VB_MED) {
+        cout << "Sequence Type detection took " << (getRealTime()-detectStart) << " seconds." << endl;
+    }
+    return type;
+}
+
+SeqType Alignment::detectSequenceType(size_t *char_count) {
     size_t num_nuc   = 0;
     size_t num_ungap = 0;
     size_t num_bin   = 0;
     size_t num_alpha = 0;
     size_t num_digit = 0;
-    double detectStart = getRealTime();
-    size_t sequenceCount = sequences.size();
-#ifdef _OPENMP
-#pragma omp parallel for reduction(+:num_nuc,num_ungap,num_bin,num_alpha,num_digit)
-#endif
-    for (size_t seqNum = 0; seqNum < sequenceCount; ++seqNum) {
-        auto start = sequences.at(seqNum).data();
-        auto stop  = start + sequences.at(seqNum).size();
-        for (auto i = start; i!=stop; ++i) {
-            if ((*i) == 'A' || (*i) == 'C' || (*i) == 'G' || (*i) == 'T' || (*i) == 'U') {
-                ++num_nuc;
-                ++num_ungap;
-                continue;
-            }
-            if ((*i)=='?' || (*i)=='-' || (*i) == '.' ) {
-                continue;
-            }
-            if (*i != 'N' && *i != 'X' &&  (*i) != '~') {
-                num_ungap++;
-                if (isdigit(*i)) {
-                    num_digit++;
-                    if ((*i) == '0' || (*i) == '1') {
-                        num_bin++;
-                    }
+    for (int c = 0; c < NUM_CHAR; c++) {
+        size_t count = char_count[c];
+        if (!count)
+            continue;
+        char ch = (char)c;
+        if (ch == 'A' || ch == 'C' || ch == 'G' || ch == 'T' || ch == 'U') {
+            num_nuc += count;
+            num_ungap += count;
+            continue;
+        }
+        if (ch == '?' || ch == '-' || ch == '.') {
+            continue;
+        }
+        if (ch != 'N' && ch != 'X' && ch != '~') {
+            num_ungap += count;
+            if (isdigit(c)) {
+                num_digit += count;
+                if (ch == '0' || ch == '1') {
+                    num_bin += count;
                 }
             }
-            if (isalpha(*i)) {
-                num_alpha++;
-            }
         }
-    }
-    if (verbose_mode >= VB_MED) {
-        cout << "Sequence Type detection took " << (getRealTime()-detectStart) << " seconds." << endl;
+        if (isalpha(c)) {
+            num_alpha += count;
+        }
     }
     if (((double)num_nuc) / num_ungap > 0.9)
         return SEQ_DNA;
@@ -1669,11 +1714,10 @@ void Alignment::initCodon(char *gene_code_id) {
 //	cout << "num_states = " << num_states << endl;
 }
 
-int getMorphStates(StrVector &sequences) {
+int getMorphStates(size_t *char_count) {
 	char maxstate = 0;
-	for (StrVector::iterator it = sequences.begin(); it != sequences.end(); it++)
-		for (string::iterator pos = it->begin(); pos != it->end(); pos++)
-			if ((*pos) > maxstate && isalnum(*pos)) maxstate = *pos;
+	for (int c = 1; c < 128; c++)
+		if (char_count[c] && isalnum(c)) maxstate = c;
 	if (maxstate >= '0' && maxstate <= '9') return (maxstate - '0' + 1);
 	if (maxstate >= 'A' && maxstate <= 'V') return (maxstate - 'A' + 11);
 	return 0;
@@ -1723,12 +1767,36 @@ string Alignment::getSeqTypeStr(SeqType sequence_type) {
 }
 
 int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq, int nsite) {
-    int seq_id;
+    vector<size_t> seq_lengths;
+    for (auto &seq : sequences)
+        seq_lengths.push_back(seq.length());
+    checkSeqNamesAndLengths(seq_lengths, nseq, nsite);
+
+    /* now check data type */
+    double detectStart = getRealTime();
+    size_t char_count[NUM_CHAR];
+    countCharacters(sequences, char_count);
+    if (verbose_mode >= VB_MED) {
+        cout << "Sequence Type detection took " << (getRealTime()-detectStart) << " seconds." << endl;
+    }
+    bool nt2aa = initSeqType(char_count, sequence_type);
+
+    // now convert to patterns
+    char char_to_state[NUM_CHAR];
+    char AA_to_state[NUM_CHAR];
+    initSitePatterns(nsite, nt2aa, char_to_state, AA_to_state);
+    int num_error = 0, num_gaps_only = 0;
     ostringstream err_str;
-    codon_table = NULL;
-    genetic_code = NULL;
-    non_stop_codon = NULL;
+    progress_display progress(nsite, "Constructing alignment", "examined", "site");
+    addSitePatterns(sequences, 0, char_to_state, AA_to_state, nt2aa, num_error, num_gaps_only, err_str, progress);
+    progress.done();
+    finishSitePatterns(num_gaps_only, err_str);
+    return 1;
+}
 
+void Alignment::checkSeqNamesAndLengths(vector<size_t> &seq_lengths, int nseq, int nsite) {
+    int seq_id;
+    ostringstream err_str;
     if (nseq != seq_names.size()) {
         throw "Different number of sequences than specified";
     }
@@ -1754,22 +1822,26 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
     }
     /* now check that all sequences have the same length */
     for (seq_id = 0; seq_id < nseq; seq_id ++) {
-        if (sequences[seq_id].length() != nsite) {
+        if (seq_lengths[seq_id] != nsite) {
             err_str << "Sequence " << seq_names[seq_id] << " contains ";
-            if (sequences[seq_id].length() < nsite)
+            if (seq_lengths[seq_id] < nsite)
                 err_str << "not enough";
             else
                 err_str << "too many";
 
-            err_str << " characters (" << sequences[seq_id].length() << ")\n";
+            err_str << " characters (" << seq_lengths[seq_id] << ")\n";
         }
     }
 
     if (err_str.str() != "")
         throw err_str.str();
+}
 
-    /* now check data type */
-    seq_type = detectSequenceType(sequences);
+bool Alignment::initSeqType(size_t *char_count, char *sequence_type) {
+    codon_table = NULL;
+    genetic_code = NULL;
+    non_stop_codon = NULL;
+    seq_type = detectSequenceType(char_count);
     switch (seq_type) {
     case SEQ_BINARY:
         num_states = 2;
@@ -1784,7 +1856,7 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
         cout << "Alignment most likely contains protein sequences" << endl;
         break;
     case SEQ_MORPH:
-        num_states = getMorphStates(sequences);
+        num_states = getMorphStates(char_count);
         if (num_states < 2 || num_states > 32) throw "Invalid number of states.";
         cout << "Alignment most likely contains " << num_states << "-state morphological data" << endl;
         break;
@@ -1816,7 +1888,7 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
             nt2aa = true;
             cout << "Translating to amino-acid sequences with genetic code " << &sequence_type[5] << " ..." << endl;
         } else if (strcmp(sequence_type, "NUM") == 0 || strcmp(sequence_type, "MORPH") == 0) {
-            num_states = getMorphStates(sequences);
+            num_states = getMorphStates(char_count);
             if (num_states < 2 || num_states > 32) throw "Invalid number of states";
             user_seq_type = SEQ_MORPH;
         } else if (strcmp(sequence_type, "TINA") == 0 || strcmp(sequence_type, "MULTI") == 0) {
@@ -1835,13 +1907,10 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
         seq_type = user_seq_type;
     }
 
-    //initStateSpace(seq_type);
-    
-    // now convert to patterns
-    int site, seq, num_gaps_only = 0;
+    return nt2aa;
+}
 
-    char char_to_state[NUM_CHAR];
-    char AA_to_state[NUM_CHAR];
+void Alignment::initSitePatterns(int nsite, bool nt2aa, char *char_to_state, char *AA_to_state) {
     computeUnknownState();
     if (nt2aa) {
         buildStateMap(char_to_state, SEQ_DNA);
@@ -1849,31 +1918,49 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
     } else
         buildStateMap(char_to_state, seq_type);
 
-    Pattern pat;
-    pat.resize(nseq);
     int step = ((seq_type == SEQ_CODON || nt2aa) ? 3 : 1);
     if (nsite % step != 0)
     	outError("Number of sites is not multiple of 3");
     site_pattern.resize(nsite/step, -1);
     clear();
     pattern_index.clear();
-    int num_error = 0;
-    
-    progress_display progress(nsite, "Constructing alignment", "examined", "site");
-    for (site = 0; site < nsite; site+=step) {
+}
+
+void Alignment::addSitePatterns(StrVector &columns, int first_site, char *char_to_state, char *AA_to_state, bool nt2aa,
+                                int &num_error, int &num_gaps_only, ostringstream &err_str, progress_display &progress)
+{
+    int nseq = columns.size();
+    int ncol = columns[0].length();
+    int site, seq;
+    Pattern pat;
+    pat.resize(nseq);
+    int step = ((seq_type == SEQ_CODON || nt2aa) ? 3 : 1);
+
+#ifdef _OPENMP
+    // sites with errors, and debug output of gap-only sites, go through the serial loop below
+    if (step == 1 && !num_error && verbose_mode < VB_DEBUG && omp_get_max_threads() > 1 &&
+        addSitePatternsParallel(columns, first_site, char_to_state, num_gaps_only)) {
+        progress += ncol;
+        return;
+    }
+#endif
+
+    for (int col = 0; col < ncol; col+=step) {
+        site = first_site + col;
         for (seq = 0; seq < nseq; seq++) {
-            //char state = convertState(sequences[seq][site], seq_type);
-            char state = char_to_state[(int)(sequences[seq][site])];
+            const string &sequence = columns[seq];
+            //char state = convertState(sequence[col], seq_type);
+            char state = char_to_state[(int)(sequence[col])];
             if (seq_type == SEQ_CODON || nt2aa) {
             	// special treatment for codon
-            	char state2 = char_to_state[(int)(sequences[seq][site+1])];
-            	char state3 = char_to_state[(int)(sequences[seq][site+2])];
+            	char state2 = char_to_state[(int)(sequence[col+1])];
+            	char state3 = char_to_state[(int)(sequence[col+2])];
             	if (state < 4 && state2 < 4 && state3 < 4) {
 //            		state = non_stop_codon[state*16 + state2*4 + state3];
             		state = state*16 + state2*4 + state3;
             		if (genetic_code[(int)state] == '*') {
                         err_str << "Sequence " << seq_names[seq] << " has stop codon " <<
-                        		sequences[seq][site] << sequences[seq][site+1] << sequences[seq][site+2] <<
+                        		sequence[col] << sequence[col+1] << sequence[col+2] <<
                         		" at site " << site+1 << endl;
                         num_error++;
                         state = STATE_UNKNOWN;
@@ -1888,7 +1975,7 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
             		if (state != STATE_UNKNOWN || state2 != STATE_UNKNOWN || state3 != STATE_UNKNOWN) {
             			ostringstream warn_str;
                         warn_str << "Sequence " << seq_names[seq] << " has ambiguous character " <<
-                        		sequences[seq][site] << sequences[seq][site+1] << sequences[seq][site+2] <<
+                        		sequence[col] << sequence[col+1] << sequence[col+2] <<
                         		" at site " << site+1;
                         outWarning(warn_str.str());
             		}
@@ -1897,9 +1984,9 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
             }
             if (state == STATE_INVALID) {
                 if (num_error < 100) {
-                    err_str << "Sequence " << seq_names[seq] << " has invalid character " << sequences[seq][site];
+                    err_str << "Sequence " << seq_names[seq] << " has invalid character " << sequence[col];
                     if (seq_type == SEQ_CODON)
-                        err_str << sequences[seq][site+1] << sequences[seq][site+2];
+                        err_str << sequence[col+1] << sequence[col+2];
                     err_str << " at site " << site+1 << endl;
                 } else if (num_error == 100)
                     err_str << "...many more..." << endl;
@@ -1915,7 +2002,85 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
         }
         progress += step;
     }
-    progress.done();
+}
+
+bool Alignment::addSitePatternsParallel(StrVector &columns, int first_site, char *char_to_state, int &num_gaps_only) {
+    int nseq = columns.size();
+    int ncol = columns[0].length();
+    int thread_count = 1;
+#ifdef _OPENMP
+    thread_count = omp_get_max_threads();
+#endif
+    int thread_sites = (ncol + thread_count - 1) / thread_count;
+    vector<vector<Pattern> > local_patterns(thread_count);
+    vector<IntVector> local_site_pattern(thread_count);
+    IntVector local_gaps_only(thread_count, 0);
+    IntVector local_invalid(thread_count, 0);
+
+    // each thread deduplicates its own site range, keeping first-occurrence order
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static,1)
+#endif
+    for (int thread = 0; thread < thread_count; thread++) {
+        int start = thread*thread_sites;
+        int stop = min(start + thread_sites, ncol);
+        PatternIntMap local_index;
+        vector<Pattern> &patterns = local_patterns[thread];
+        IntVector &site_ptn = local_site_pattern[thread];
+        Pattern pat;
+        pat.resize(nseq);
+        for (int col = start; col < stop && !local_invalid[thread]; col++) {
+            bool gaps_only = true;
+            for (int seq = 0; seq < nseq; seq++) {
+                char state = char_to_state[(int)(columns[seq][col])];
+                if (state == STATE_INVALID)
+                    local_invalid[thread] = 1;
+                if (state != STATE_UNKNOWN)
+                    gaps_only = false;
+                pat[seq] = state;
+            }
+            if (gaps_only)
+                local_gaps_only[thread]++;
+            auto pat_it = local_index.find(pat);
+            if (pat_it == local_index.end()) {
+                pat.frequency = 1;
+                local_index[pat] = patterns.size();
+                site_ptn.push_back(patterns.size());
+                patterns.push_back(pat);
+            } else {
+                patterns[pat_it->second].frequency++;
+                site_ptn.push_back(pat_it->second);
+            }
+        }
+    }
+    for (auto invalid : local_invalid)
+        if (invalid)
+            return false;
+
+    // merge in thread order, such that new patterns are appended by their first site
+    for (int thread = 0; thread < thread_count; thread++) {
+        vector<Pattern> &patterns = local_patterns[thread];
+        IntVector local_to_global(patterns.size());
+        for (size_t i = 0; i < patterns.size(); i++) {
+            PatternIntMap::iterator pat_it = pattern_index.find(patterns[i]);
+            if (pat_it == pattern_index.end()) {
+                push_back(patterns[i]);
+                pattern_index[back()] = size()-1;
+                local_to_global[i] = size()-1;
+            } else {
+                at(pat_it->second).frequency += patterns[i].frequency;
+                local_to_global[i] = pat_it->second;
+            }
+        }
+        int site = first_site + thread*thread_sites;
+        for (auto ptn : local_site_pattern[thread])
+            site_pattern[site++] = local_to_global[ptn];
+        num_gaps_only += local_gaps_only[thread];
+    }
+    return true;
+}
+
+void Alignment::finishSitePatterns(int num_gaps_only, ostringstream &err_str) {
     updatePatterns(0);
     if (num_gaps_only) {
         cout << "WARNING: " << num_gaps_only << " sites contain only gaps or ambiguous characters." << endl;
@@ -1923,7 +2088,6 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
     if (err_str.str() != "") {
         throw err_str.str();
     }
-    return 1;
 }
 
 void processSeq(string &sequence, string &line, int line_num) {
@@ -2152,7 +2316,173 @@ void Alignment::doReadFasta(char *filename, char *sequence_type, StrVector &sequ
     in.exceptions(ios::failbit | ios::badbit);
     in.close();
 
-    // now try to cut down sequence name if possible
+    shortenSeqNames();
+    
+    nseq = seq_names.size();
+    nsite = sequences.front().length();
+    
+}
+
+/** magic number and format version of the binary alignment cache */
+const char ALN_CACHE_MAGIC[8] = {'I', 'Q', 'A', 'L', 'N', 'B', 'I', 'N'};
+const int32_t ALN_CACHE_VERSION = 1;
+
+/**
+    get the size and modification time of a file, to detect outdated caches
+*/
+void getFileStamp(const char *filename, int64_t &size, int64_t &mtime) {
+    struct stat st;
+    if (stat(filename, &st) != 0) {
+        size = mtime = -1;
+        return;
+    }
+    size = st.st_size;
+    mtime = st.st_mtime;
+}
+
+template <class T>
+void writeCacheValue(ostream &out, T value) {
+    out.write((const char*)&value, sizeof(T));
+}
+
+template <class T>
+bool readCacheValue(istream &in, T &value) {
+    in.read((char*)&value, sizeof(T));
+    return in.good();
+}
+
+void writeCacheString(ostream &out, const string &str) {
+    writeCacheValue(out, (int32_t)str.length());
+    out.write(str.data(), str.length());
+}
+
+bool readCacheString(istream &in, string &str) {
+    int32_t len;
+    if (!readCacheValue(in, len) || len < 0)
+        return false;
+    str.resize(len);
+    in.read(&str[0], len);
+    return in.good();
+}
+
+void Alignment::writeAlignmentCache(const char *cache_file, const char *aln_file) {
+    ofstream out(cache_file, ios::out | ios::binary);
+    if (!out.is_open()) {
+        outWarning("Cannot write alignment cache " + string(cache_file));
+        return;
+    }
+    int64_t file_size, file_time;
+    getFileStamp(aln_file, file_size, file_time);
+    size_t nseq = getNSeq(), nptn = size(), nsite = site_pattern.size();
+    // states of DNA, protein, codon and morphological data fit into one byte
+    uint8_t state_bytes = (STATE_UNKNOWN < 256) ? 1 : sizeof(StateType);
+
+    out.write(ALN_CACHE_MAGIC, sizeof(ALN_CACHE_MAGIC));
+    writeCacheValue(out, ALN_CACHE_VERSION);
+    writeCacheValue(out, file_size);
+    writeCacheValue(out, file_time);
+    writeCacheString(out, sequence_type);
+    writeCacheValue(out, (int32_t)seq_type);
+    writeCacheValue(out, (int32_t)num_states);
+    writeCacheValue(out, (uint32_t)STATE_UNKNOWN);
+    writeCacheValue(out, state_bytes);
+    writeCacheValue(out, (int64_t)nseq);
+    writeCacheValue(out, (int64_t)nptn);
+    writeCacheValue(out, (int64_t)nsite);
+    for (auto &seq_name : seq_names)
+        writeCacheString(out, seq_name);
+    vector<char> buffer(nseq*state_bytes);
+    for (auto &pat : *this) {
+        writeCacheValue(out, (int32_t)pat.frequency);
+        for (size_t seq = 0; seq < nseq; seq++)
+            if (state_bytes == 1)
+                buffer[seq] = pat[seq];
+            else
+                memcpy(&buffer[seq*state_bytes], &pat[seq], state_bytes);
+        out.write(buffer.data(), buffer.size());
+    }
+    vector<int32_t> site_ptn(site_pattern.begin(), site_pattern.end());
+    out.write((const char*)site_ptn.data(), site_ptn.size()*sizeof(int32_t));
+    out.close();
+    if (!out)
+        outWarning("Cannot write alignment cache " + string(cache_file));
+    else
+        cout << "Alignment written to binary cache " << cache_file << endl;
+}
+
+bool Alignment::readAlignmentCache(const char *cache_file, const char *aln_file) {
+    ifstream in(cache_file, ios::in | ios::binary);
+    if (!in.is_open())
+        return false;
+    char magic[sizeof(ALN_CACHE_MAGIC)];
+    int32_t version, cache_seq_type, cache_num_states;
+    int64_t file_size, file_time, cache_size, cache_time, nseq, nptn, nsite;
+    uint32_t cache_unknown;
+    uint8_t state_bytes;
+    string cache_sequence_type;
+    getFileStamp(aln_file, file_size, file_time);
+    in.read(magic, sizeof(magic));
+    if (!in.good() || memcmp(magic, ALN_CACHE_MAGIC, sizeof(magic)) != 0)
+        return false;
+    if (!readCacheValue(in, version) || version != ALN_CACHE_VERSION ||
+        !readCacheValue(in, cache_size) || !readCacheValue(in, cache_time) ||
+        cache_size != file_size || cache_time != file_time ||
+        !readCacheString(in, cache_sequence_type) || cache_sequence_type != sequence_type)
+        return false;
+    if (!readCacheValue(in, cache_seq_type) || !readCacheValue(in, cache_num_states) ||
+        !readCacheValue(in, cache_unknown) || !readCacheValue(in, state_bytes) ||
+        !readCacheValue(in, nseq) || !readCacheValue(in, nptn) || !readCacheValue(in, nsite) ||
+        (state_bytes != 1 && state_bytes != sizeof(StateType)))
+        return false;
+
+    StrVector names(nseq);
+    for (auto &name : names)
+        if (!readCacheString(in, name))
+            return false;
+    vector<Pattern> patterns(nptn);
+    vector<char> buffer(nseq*state_bytes);
+    for (auto &pat : patterns) {
+        int32_t freq;
+        if (!readCacheValue(in, freq))
+            return false;
+        in.read(buffer.data(), buffer.size());
+        if (!in.good())
+            return false;
+        pat.frequency = freq;
+        pat.resize(nseq);
+        for (size_t seq = 0; seq < nseq; seq++)
+            if (state_bytes == 1)
+                pat[seq] = (unsigned char)buffer[seq];
+            else
+                memcpy(&pat[seq], &buffer[seq*state_bytes], state_bytes);
+    }
+    vector<int32_t> site_ptn(nsite);
+    in.read((char*)site_ptn.data(), nsite*sizeof(int32_t));
+    if (in.gcount() != (streamsize)(nsite*sizeof(int32_t)))
+        return false;
+
+    // the cache is consistent, take it over
+    seq_names.swap(names);
+    seq_type = (SeqType)cache_seq_type;
+    if (sequence_type.substr(0, 5) == "CODON" || sequence_type.substr(0, 5) == "NT2AA") {
+        string gene_code_id = sequence_type.substr(5);
+        initCodon(&gene_code_id[0]);
+    }
+    num_states = cache_num_states;
+    STATE_UNKNOWN = cache_unknown;
+    clear();
+    pattern_index.clear();
+    for (auto &pat : patterns) {
+        push_back(std::move(pat));
+        pattern_index[back()] = size()-1;
+    }
+    site_pattern.assign(site_ptn.begin(), site_ptn.end());
+    updatePatterns(0);
+    return true;
+}
+
+void Alignment::shortenSeqNames() {
+    // cut down sequence names if possible
     int i, step = 0;
     StrVector new_seq_names, remain_seq_names;
     new_seq_names.resize(seq_names.size());
@@ -2194,13 +2524,23 @@ void Alignment::doReadFasta(char *filename, char *sequence_type, StrVector &sequ
     }
 
     seq_names = new_seq_names;
-    
-    nseq = seq_names.size();
-    nsite = sequences.front().length();
-    
+}
+
+/**
+    @param filename file name
+    @return true if the file starts with the gzip magic number
+*/
+bool isGzipFile(const char *filename) {
+    ifstream in(filename, ios::in | ios::binary);
+    unsigned char magic[2] = {0, 0};
+    in.read((char*)magic, 2);
+    return in.gcount() == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
 }
 
 int Alignment::readFasta(char *filename, char *sequence_type) {
+    if (!isGzipFile(filename))
+        return readFastaStreaming(filename, sequence_type);
+
     StrVector sequences;
     int nseq = 0;
     int nsite = 0;
@@ -2211,6 +2551,114 @@ int Alignment::readFasta(char *filename, char *sequence_type) {
     return buildPattern(sequences, sequence_type, nseq, nsite);
 }
 
+/** maximal size of the block of columns held in memory by readFastaStreaming() */
+const size_t FASTA_BLOCK_BYTES = 64*1024*1024;
+
+int Alignment::readFastaStreaming(char *filename, char *sequence_type) {
+    ifstream in;
+    int line_num = 1;
+    string line, line_seq;
+    vector<size_t> seq_lengths;
+    // file offset of the first sequence character not yet read, for each sequence
+    vector<int64_t> seq_offsets;
+    size_t char_count[NUM_CHAR];
+    memset(char_count, 0, sizeof(char_count));
+
+    // set the failbit and badbit
+    in.exceptions(ios::failbit | ios::badbit);
+    in.open(filename, ios::in | ios::binary);
+    in.seekg(0, ios::end);
+    int64_t file_length = in.tellg();
+    in.seekg(0, ios::beg);
+    // remove the failbit
+    in.exceptions(ios::badbit);
+
+    // first pass: names, lengths and character counts, validating the lines like doReadFasta()
+    {
+        progress_display progress(file_length, "Reading fasta file", "", "");
+        int64_t read_bytes = 0;
+        for (; !in.eof(); line_num++) {
+            safeGetline(in, line);
+            read_bytes += line.length() + 1;
+            if (line == "") {
+                continue;
+            }
+            if (line[0] == '>') { // next sequence
+                string::size_type pos = line.find_first_of("\n\r");
+                seq_names.push_back(line.substr(1, pos-1));
+                trimString(seq_names.back());
+                seq_lengths.push_back(0);
+                seq_offsets.push_back(in.eof() ? file_length : (int64_t)in.tellg());
+                continue;
+            }
+            // read sequence contents
+            if (seq_lengths.empty()) {
+                throw "First line must begin with '>' to define sequence name";
+            }
+            line_seq.clear();
+            processSeq(line_seq, line, line_num);
+            seq_lengths.back() += line_seq.length();
+            for (auto ch : line_seq)
+                char_count[(unsigned char)ch]++;
+            progress = (double)read_bytes;
+        }
+    }
+    in.clear();
+
+    if (seq_names.empty()) {
+        throw "No sequence found";
+    }
+    shortenSeqNames();
+    int nseq = seq_names.size();
+    int nsite = seq_lengths.front();
+    checkSeqNamesAndLengths(seq_lengths, nseq, nsite);
+    bool nt2aa = initSeqType(char_count, sequence_type);
+
+    // second pass: convert blocks of columns into patterns
+    char char_to_state[NUM_CHAR];
+    char AA_to_state[NUM_CHAR];
+    initSitePatterns(nsite, nt2aa, char_to_state, AA_to_state);
+    int step = ((seq_type == SEQ_CODON || nt2aa) ? 3 : 1);
+    int block_sites = max((size_t)step, FASTA_BLOCK_BYTES / nseq / step * step);
+    block_sites = min(block_sites, nsite);
+    StrVector columns(nseq);
+    int num_error = 0, num_gaps_only = 0;
+    ostringstream err_str;
+    streambuf *buf = in.rdbuf();
+    progress_display progress(nsite, "Constructing alignment", "examined", "site");
+    for (int first_site = 0; first_site < nsite; first_site += block_sites) {
+        size_t ncol = min(block_sites, nsite - first_site);
+        for (int seq = 0; seq < nseq; seq++) {
+            string &column = columns[seq];
+            column.clear();
+            buf->pubseekpos(seq_offsets[seq]);
+            // characters were validated in the first pass, convert them as processSeq() does
+            while (column.length() < ncol) {
+                int c = buf->sbumpc();
+                seq_offsets[seq]++;
+                if (c == EOF) {
+                    throw "Unexpected end of file while reading sequence " + seq_names[seq];
+                }
+                char ch = c;
+                if (ch <= ' ') continue;
+                if (ch == '(' || ch == '{') {
+                    do {
+                        c = buf->sbumpc();
+                        seq_offsets[seq]++;
+                    } while (c != ')' && c != '}' && c != EOF);
+                    column.append(1, '?');
+                } else
+                    column.append(1, toupper(ch));
+            }
+        }
+        addSitePatterns(columns, first_site, char_to_state, AA_to_state, nt2aa, num_error, num_gaps_only, err_str, progress);
+    }
+    progress.done();
+    in.close();
+    finishSitePatterns(num_gaps_only, err_str);
+    return 1;
+}
+
 void Alignment::doReadClustal(char *filename, char *sequence_type, StrVector &sequences, int &nseq, int &nsite){
     igzstream in;
     int line_num = 1;
@@ -4095,6 +4543,16 @@ void Alignment::countConstSite() {
     }
     frac_const_sites = ((double)num_const_sites) / getNSite();
     frac_invariant_sites = ((double)num_invariant_sites) / getNSite();
+    // every routine (re)building the patterns ends here
+    buildPackedStates();
+}
+
+void Alignment::buildPackedStates() {
+    if (seq_type == SEQ_POMO || !pomo_sampled_states.empty()) {
+        packed_states.clear();
+        return;
+    }
+    packed_states.build(*this, getNSeq(), seq_type, num_states, STATE_UNKNOWN);
 }
 
 /**
@@ -4205,6 +4663,13 @@ void Alignment::getUnobservedConstPatterns(ASCType ASC_type, vector<Pattern> &un
 
 int Alignment::countProperChar(int seq_id) {
     int num_proper_chars = 0;
+    if (hasPackedStates()) {
+        size_t nptn = size();
+        for (size_t ptn = 0; ptn < nptn; ptn++)
+            if (packed_states.isProper(packed_states.getCode(seq_id, ptn)))
+                num_proper_chars += at(ptn).frequency;
+        return num_proper_chars;
+    }
     for (iterator it = begin(); it != end(); it++) {
         if ((*it)[seq_id] < num_states + pomo_sampled_states.size()) {
             num_proper_chars+=(*it).frequency;
@@ -4231,15 +4696,31 @@ Alignment::~Alignment()
 double Alignment::computeObsDist(int seq1, int seq2) {
     int diff_pos = 0, total_pos = 0;
     total_pos = getNSite() - num_variant_sites; // initialize with number of constant sites
-    for (iterator it = begin(); it != end(); it++) {
-        if ((*it).isConst())
-            continue;
-        int state1 = convertPomoState((*it)[seq1]);
-        int state2 = convertPomoState((*it)[seq2]);
-        if  (state1 < num_states && state2 < num_states) {
-            total_pos += (*it).frequency;
-            if (state1 != state2 )
-                diff_pos += (*it).frequency;
+    if (hasPackedStates()) {
+        // identical codes mean identical states, see PackedStateMatrix
+        size_t nptn = size();
+        for (size_t ptn = 0; ptn < nptn; ptn++) {
+            if (at(ptn).isConst())
+                continue;
+            uint8_t code1 = packed_states.getCode(seq1, ptn);
+            uint8_t code2 = packed_states.getCode(seq2, ptn);
+            if (packed_states.isProper(code1) && packed_states.isProper(code2)) {
+                total_pos += at(ptn).frequency;
+                if (code1 != code2)
+                    diff_pos += at(ptn).frequency;
+            }
+        }
+    } else {
+        for (iterator it = begin(); it != end(); it++) {
+            if ((*it).isConst())
+                continue;
+            int state1 = convertPomoState((*it)[seq1]);
+            int state2 = convertPomoState((*it)[seq2]);
+            if  (state1 < num_states && state2 < num_states) {
+                total_pos += (*it).frequency;
+                if (state1 != state2 )
+                    diff_pos += (*it).frequency;
+            }
         }
     }
     if (!total_pos) {
@@ -16,12 +16,15 @@
 #include <vector>
 #include <bitset>
 #include "pattern.h"
+#include "packedstates.h"
 #include "ncl/ncl.h"
 
 const double MIN_FREQUENCY          = 0.0001;
 const double MIN_FREQUENCY_DIFF     = 0.00001;
 
 const int NUM_CHAR = 256;
+
+class progress_display;
 typedef bitset<NUM_CHAR> StateBitset;
 
 /** class storing results of symmetry tests */
@@ -200,6 +203,61 @@ public:
     int readNexus(char *filename);
 
     int buildPattern(StrVector &sequences, char *sequence_type, int nseq, int nsite);
+
+    /**
+            check that sequence names are given and unique and that all sequences have nsite characters
+            @param seq_lengths number of characters of each sequence
+            @param nseq number of sequences
+            @param nsite number of sites
+     */
+    void checkSeqNamesAndLengths(vector<size_t> &seq_lengths, int nseq, int nsite);
+
+    /**
+            set seq_type and num_states from the detected and the user-specified data type
+            @param char_count number of occurrences of each character over all sequences
+            @param sequence_type type of the sequence, either "BIN", "DNA", "AA", or NULL
+            @return true if codons are translated into amino acids (NT2AA)
+     */
+    bool initSeqType(size_t *char_count, char *sequence_type);
+
+    /**
+            remove all patterns and build the state maps before calling addSitePatterns()
+            @param nsite number of sites
+            @param nt2aa true if codons are translated into amino acids
+            @param[out] char_to_state, AA_to_state state maps
+     */
+    void initSitePatterns(int nsite, bool nt2aa, char *char_to_state, char *AA_to_state);
+
+    /**
+            convert a block of consecutive sites into patterns
+            @param columns characters of the sites, one string per sequence, all of the same length
+            @param first_site ID of the first site of the block
+            @param char_to_state, AA_to_state state maps from initSitePatterns()
+            @param nt2aa true if codons are translated into amino acids
+            @param[in,out] num_error, num_gaps_only, err_str accumulated over all blocks
+            @param progress progress display over all sites
+     */
+    void addSitePatterns(StrVector &columns, int first_site, char *char_to_state, char *AA_to_state, bool nt2aa,
+                         int &num_error, int &num_gaps_only, ostringstream &err_str, progress_display &progress);
+
+    /**
+            convert a block of non-codon sites into patterns with one hash table per thread over
+            consecutive site ranges, then merge them in thread order, giving the same pattern
+            order and site_pattern as addSitePatterns()
+            @param columns characters of the sites, one string per sequence, all of the same length
+            @param first_site ID of the first site of the block
+            @param char_to_state state map from initSitePatterns()
+            @param[in,out] num_gaps_only number of sites with only gaps
+            @return false without changing the patterns if a site has an invalid character
+     */
+    bool addSitePatternsParallel(StrVector &columns, int first_site, char *char_to_state, int &num_gaps_only);
+
+    /**
+            compute the pattern properties once all sites were added
+            @param num_gaps_only number of sites with only gaps
+            @param err_str errors collected by addSitePatterns(), thrown if not empty
+     */
+    void finishSitePatterns(int num_gaps_only, ostringstream &err_str);
     
     /**
             do-read the alignment in PHYLIP format (interleaved)
@@ -249,6 +307,38 @@ public:
      */
     int readFasta(char *filename, char *sequence_type);
 
+    /**
+            read an uncompressed FASTA file in two passes without holding all sequences in memory:
+            the first pass validates the sequences and records where each one starts,
+            the second pass builds the patterns from blocks of columns
+            @param filename file name
+            @param sequence_type type of the sequence, either "BIN", "DNA", "AA", or NULL
+            @return 1 on success
+     */
+    int readFastaStreaming(char *filename, char *sequence_type);
+
+    /**
+            load patterns, site_pattern, sequence names and data type from a binary cache written by
+            writeAlignmentCache(), if it matches the size and modification time of the alignment file
+            and the sequence type
+            @param cache_file cache file name
+            @param aln_file alignment file name
+            @return true if the cache was loaded, false if it is missing or outdated
+     */
+    bool readAlignmentCache(const char *cache_file, const char *aln_file);
+
+    /**
+            write the parsed alignment into a binary cache for readAlignmentCache()
+            @param cache_file cache file name
+            @param aln_file alignment file name
+     */
+    void writeAlignmentCache(const char *cache_file, const char *aln_file);
+
+    /**
+            shorten FASTA sequence names to the first word(s) as long as they stay unique
+     */
+    void shortenSeqNames();
+
     /** 
      * Read the alignment in counts format (PoMo).
      *
@@ -337,6 +427,13 @@ public:
      ****************************************************************************/
     SeqType detectSequenceType(StrVector &sequences);
 
+    /**
+            detect the data type from character counts
+            @param char_count number of occurrences of each character over all sequences
+            @return the data type of the sequences
+     */
+    SeqType detectSequenceType(size_t *char_count);
+
     void computeUnknownState();
 
     void buildStateMap(char *map, SeqType seq_type);
@@ -830,6 +927,19 @@ public:
      */
     virtual void countConstSite();
 
+    /**
+            rebuild packed_states from the current patterns
+     */
+    void buildPackedStates();
+
+    /**
+            @return true if packed_states is in sync with the patterns
+     */
+    bool hasPackedStates() const {
+        return !packed_states.empty() && packed_states.getNPattern() == size() &&
+            packed_states.getNSeq() == seq_names.size();
+    }
+
     /**
      * generate uninformative patterns
      */
@@ -862,6 +972,12 @@ public:
 
     StateType STATE_UNKNOWN;
 
+    /**
+            pattern states stored taxon-major, rebuilt whenever the patterns change
+            (empty for PoMo or when states do not fit into one byte)
+     */
+    PackedStateMatrix packed_states;
+
     /**
             fraction of constant sites
      */
@@ -19,6 +19,9 @@
  ***************************************************************************/
 #include "alignmentpairwise.h"
 #include "tree/phylosupertree.h"
+#include "model/modelmarkov.h"
+#include <vectorclass/vectorclass.h>
+#include <vectorclass/vectormath_exp.h>
 
 AlignmentPairwise::AlignmentPairwise()
         : Alignment(), Optimization()
@@ -480,39 +483,47 @@ double AlignmentPairwise::optimizeDist(double initial_dist) {
 	return optimizeDist(initial_dist, d2l);
 }
 
+double AlignmentPairwise::computeInitialDist(PhyloTree *atree, int seq1, int seq2) {
+    if (!atree->hasMatrixOfConvertedSequences()) {
+        if (atree->params->compute_obs_dist)
+            return atree->aln->computeObsDist(seq1, seq2);
+        return atree->aln->computeDist(seq1, seq2);
+    }
+    int distance    = 0;
+    int denominator = 0;
+    StateType unknown     = atree->aln->STATE_UNKNOWN;
+    auto sequence1        = atree->getConvertedSequenceByNumber(seq1);
+    auto sequence2        = atree->getConvertedSequenceByNumber(seq2);
+    auto nonConstSiteFreq = atree->getConvertedSequenceNonConstFrequencies();
+    size_t sequenceLength = atree->getConvertedSequenceLength();
+    for (size_t i=0; i<sequenceLength; ++i) {
+        auto state1 = sequence1[i];
+        auto state2 = sequence2[i];
+        if ( state1 != unknown && state2 != unknown ) {
+            denominator += nonConstSiteFreq[i];
+            if ( state1 != state2 ) {
+                distance += nonConstSiteFreq[i];
+            }
+        }
+    }
+    double obs_dist = 0.0;
+    if (0<distance) {
+        obs_dist = (double)distance / (double)denominator;
+    }
+    if (atree->params->compute_obs_dist) {
+        return obs_dist;
+    }
+    return atree->aln->computeJCDistanceFromObservedDistance(obs_dist);
+}
+
 double AlignmentPairwise::recomputeDist
     ( int seq1, int seq2, double initial_dist, double &d2l ) {
     //Only called when -experimental has been passed
     if (initial_dist == 0.0) {
-        if (tree->hasMatrixOfConvertedSequences()) {
-            int distance    = 0;
-            int denominator = 0;
-            auto sequence1        = tree->getConvertedSequenceByNumber(seq1);
-            auto sequence2        = tree->getConvertedSequenceByNumber(seq2);
-            auto nonConstSiteFreq = tree->getConvertedSequenceNonConstFrequencies();
-            size_t sequenceLength = tree->getConvertedSequenceLength();
-            for (size_t i=0; i<sequenceLength; ++i) {
-                auto state1 = sequence1[i];
-                auto state2 = sequence2[i];
-                if ( state1 != STATE_UNKNOWN && state2 != STATE_UNKNOWN ) {
-                    denominator += nonConstSiteFreq[i];
-                    if ( state1 != state2 ) {
-                        distance += nonConstSiteFreq[i];
-                    }
-                }
-            }
-            if (0<distance) {
-                initial_dist = (double)distance / (double)denominator;
-            }
-            if (tree->params->compute_obs_dist) {
-                return initial_dist;
-            }
-            initial_dist = tree->aln->computeJCDistanceFromObservedDistance(initial_dist);
+        initial_dist = computeInitialDist(tree, seq1, seq2);
+        if (tree->params->compute_obs_dist) {
+            return initial_dist;
         }
-        else if (tree->params->compute_obs_dist)
-            return (initial_dist = tree->aln->computeObsDist(seq1, seq2));
-        else
-            initial_dist = tree->aln->computeDist(seq1, seq2);
     }
     if (!tree->hasModelFactory() || !tree->hasRateHeterogeneity())
     {
@@ -533,3 +544,225 @@ AlignmentPairwise::~AlignmentPairwise()
     delete [] trans_mat;
     delete [] pair_freq;
 }
+
+AlignmentPairwiseBatch::AlignmentPairwiseBatch(PhyloTree *atree) {
+    tree = atree;
+    num_states = tree->aln->num_states;
+    padded_states = (num_states + 3) / 4 * 4;
+    ModelMarkov *model = dynamic_cast<ModelMarkov*>(tree->getModel());
+    ASSERT(model);
+    double *eval = model->getEigenvalues();
+    double *evec = model->getEigenvectors();
+    double *inv_evec = model->getInverseEigenvectors();
+    eigenvalues.resize(padded_states, 0.0);
+    eigenvalues_derv.resize(padded_states, 0.0);
+    for (int k = 0; k < num_states; k++) {
+        eigenvalues[k] = eval[k] / model->total_num_subst;
+        eigenvalues_derv[k] = eval[k];
+    }
+    eigen_coeff.resize(num_states*num_states*padded_states, 0.0);
+    for (int i = 0; i < num_states; i++)
+        for (int j = 0; j < num_states; j++) {
+            double *coeff = &eigen_coeff[(i*num_states+j)*padded_states];
+            for (int k = 0; k < num_states; k++)
+                coeff[k] = evec[i*num_states+k] * inv_evec[k*num_states+j];
+        }
+    // same rates and proportions as AlignmentPairwise::computeFuncDerv()
+    RateHeterogeneity *site_rate = tree->getRate();
+    int ncat = site_rate->getNDiscreteRate();
+    bool no_gamma = (tree->getModelFactory()->site_rate->getGammaShape() == 0.0);
+    for (int cat = 0; cat < ncat; cat++) {
+        cat_rate.push_back(no_gamma ? 1.0 : site_rate->getRate(cat));
+        cat_prop.push_back(site_rate->getProp(cat));
+    }
+    p_invar = site_rate->getPInvar();
+    min_dist = Params::getInstance().min_branch_length;
+    max_dist = MAX_GENETIC_DIST;
+}
+
+bool AlignmentPairwiseBatch::isApplicable(PhyloTree *atree) {
+    if (!atree->getModelFactory() || !atree->getRate() || !atree->optimize_by_newton)
+        return false;
+    if (atree->isSuperTree() || atree->params->store_trans_matrix)
+        return false;
+    if (atree->aln->seq_type == SEQ_POMO)
+        return false;
+    ModelSubst *model = atree->getModel();
+    RateHeterogeneity *site_rate = atree->getRate();
+    if (model->isMixture() || model->isSiteSpecificModel() || !model->isReversible())
+        return false;
+    if (site_rate->isSiteSpecificRate() || site_rate->getPtnCat(0) >= 0)
+        return false;
+    ModelMarkov *markov = dynamic_cast<ModelMarkov*>(model);
+    return markov && markov->getEigenvalues() && markov->getEigenvectors() && markov->getInverseEigenvectors();
+}
+
+void AlignmentPairwiseBatch::computePairFreq(int seq1, int seq2, double *pair_freq) const {
+    Alignment *aln = tree->aln;
+    size_t nptn = aln->getNPattern();
+    memset(pair_freq, 0, sizeof(double)*num_states*num_states);
+    if (aln->hasPackedStates()) {
+        const PackedStateMatrix &packed = aln->packed_states;
+        if (packed.getBits() == 8) {
+            const uint8_t *row1 = packed.getRow(seq1), *row2 = packed.getRow(seq2);
+            for (size_t ptn = 0; ptn < nptn; ptn++)
+                if (row1[ptn] < num_states && row2[ptn] < num_states)
+                    pair_freq[row1[ptn]*num_states + row2[ptn]] += aln->at(ptn).frequency;
+            return;
+        }
+        for (size_t ptn = 0; ptn < nptn; ptn++) {
+            StateType state1 = packed.getState(seq1, ptn), state2 = packed.getState(seq2, ptn);
+            if (state1 < num_states && state2 < num_states)
+                pair_freq[state1*num_states + state2] += aln->at(ptn).frequency;
+        }
+        return;
+    }
+    for (auto it = aln->begin(); it != aln->end(); it++) {
+        StateType state1 = (*it)[seq1], state2 = (*it)[seq2];
+        if (state1 < num_states && state2 < num_states)
+            pair_freq[state1*num_states + state2] += it->frequency;
+    }
+}
+
+void AlignmentPairwiseBatch::computeFuncDerv(double value, const int *entries, const double *freqs, size_t nentries,
+    double *exp_sum, double *exp_derv1, double *exp_derv2, double &df, double &ddf) const
+{
+    // sums over the categories of exp(eigenvalue*rate*value), weighted as in AlignmentPairwise::computeFuncDerv()
+    size_t ncat = cat_rate.size();
+    for (int k = 0; k < padded_states; k += 4) {
+        Vec4d eval, eval_derv, sum(0.0), derv1(0.0), derv2(0.0);
+        eval.load(&eigenvalues[k]);
+        eval_derv.load(&eigenvalues_derv[k]);
+        for (size_t cat = 0; cat < ncat; cat++) {
+            double rate = cat_rate[cat], prop = cat_prop[cat];
+            Vec4d eval_exp = exp(eval * (value * rate));
+            sum += eval_exp * prop;
+            derv1 += eval_exp * (prop * rate);
+            derv2 += eval_exp * (prop * rate * rate);
+        }
+        sum.store(exp_sum + k);
+        (derv1 * eval_derv).store(exp_derv1 + k);
+        (derv2 * eval_derv * eval_derv).store(exp_derv2 + k);
+    }
+    df = ddf = 0.0;
+    for (size_t e = 0; e < nentries; e++) {
+        const double *coeff = &eigen_coeff[entries[e]*padded_states];
+        Vec4d trans(0.0), trans_derv1(0.0), trans_derv2(0.0);
+        for (int k = 0; k < padded_states; k += 4) {
+            Vec4d c;
+            c.load(coeff + k);
+            trans = mul_add(c, Vec4d().load(exp_sum + k), trans);
+            trans_derv1 = mul_add(c, Vec4d().load(exp_derv1 + k), trans_derv1);
+            trans_derv2 = mul_add(c, Vec4d().load(exp_derv2 + k), trans_derv2);
+        }
+        double sum_trans = horizontal_add(trans);
+        if (entries[e] % (num_states+1) == 0)
+            sum_trans += p_invar;
+        if (sum_trans > 0.0) {
+            double d1 = horizontal_add(trans_derv1) / sum_trans;
+            df  -= freqs[e] * d1;
+            ddf -= freqs[e] * (horizontal_add(trans_derv2)/sum_trans - d1 * d1);
+        }
+    }
+}
+
+bool AlignmentPairwiseBatch::updateNewton(NewtonState &state, double f, double df, double &result) const {
+    const int max_step = 100;
+    double xacc = min_dist;
+    if (!std::isfinite(f) || !std::isfinite(df))
+        nrerror("Wrong computeFuncDerv");
+    if (state.step == 0) {
+        state.d2l = df;
+        if (df >= 0.0 && fabs(f) < xacc) {
+            result = state.rts;
+            return true;
+        }
+        if (f < 0.0) {
+            state.xl = state.rts;
+            state.xh = max_dist;
+        } else {
+            state.xh = state.rts;
+            state.xl = min_dist;
+        }
+        state.dx = state.dxold = fabs(state.xh - state.xl);
+    } else {
+        if (df > 0.0 && fabs(f) < xacc) {
+            state.d2l = df;
+            result = state.rts;
+            return true;
+        }
+        if (f < 0.0)
+            state.xl = state.rts;
+        else if (f > 0.0)
+            state.xh = state.rts;
+    }
+    state.step++;
+    state.rts_old = state.rts;
+    state.dxold = state.dx;
+    state.d2l = df;
+    if (df <= 0.0 || ((state.rts-state.xh)*df-f)*((state.rts-state.xl)*df-f) >= 0.0) {
+        // bisection
+        state.dx = 0.5*(state.xh-state.xl);
+        state.rts = state.xl+state.dx;
+        if (state.xl == state.rts) {
+            result = state.rts;
+            return true;
+        }
+    } else {
+        state.dx = f/df;
+        double temp = state.rts;
+        state.rts -= state.dx;
+        if (temp == state.rts) {
+            result = state.rts;
+            return true;
+        }
+    }
+    if (fabs(state.dx) < xacc || state.step == max_step) {
+        result = state.rts_old;
+        return true;
+    }
+    return false;
+}
+
+void AlignmentPairwiseBatch::optimizeDists(size_t npairs, const int *seq1, const int *seq2, double *dist, double *d2l) const {
+    // observed entries of the pair tables, as in AlignmentPairwise::computeFuncDerv()
+    int num_states_squared = num_states*num_states;
+    double min_freq = Params::getInstance().min_branch_length;
+    vector<int> entries;
+    DoubleVector freqs, pair_freq(num_states_squared);
+    vector<size_t> first_entry(npairs+1, 0);
+    for (size_t pair = 0; pair < npairs; pair++) {
+        computePairFreq(seq1[pair], seq2[pair], pair_freq.data());
+        for (int i = 0; i < num_states_squared; i++)
+            if (pair_freq[i] > min_freq) {
+                entries.push_back(i);
+                freqs.push_back(pair_freq[i]);
+            }
+        first_entry[pair+1] = entries.size();
+    }
+
+    DoubleVector workspace(3*padded_states);
+    vector<NewtonState> states(npairs);
+    vector<size_t> active;
+    for (size_t pair = 0; pair < npairs; pair++) {
+        states[pair].rts = min(max(dist[pair], min_dist), max_dist);
+        states[pair].step = 0;
+        active.push_back(pair);
+    }
+    // all unfinished pairs take one Newton step per round
+    while (!active.empty()) {
+        size_t remaining = 0;
+        for (size_t pair : active) {
+            NewtonState &state = states[pair];
+            double f, df;
+            computeFuncDerv(state.rts, &entries[0] + first_entry[pair], &freqs[0] + first_entry[pair],
+                first_entry[pair+1] - first_entry[pair], &workspace[0], &workspace[padded_states],
+                &workspace[2*padded_states], f, df);
+            if (updateNewton(state, f, df, dist[pair]))
+                d2l[pair] = state.d2l;
+            else
+                active[remaining++] = pair;
+        }
+        active.resize(remaining);
+    }
+}
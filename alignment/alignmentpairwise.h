@@ -106,6 +106,14 @@ public:
     */
 
     virtual double recomputeDist( int seq1, int seq2, double initial_dist, double &d2l );
+
+    /**
+        initial estimate of the distance between two sequences, as used by recomputeDist()
+        @param atree tree with the alignment, over its converted sequences if it has them
+        @param seq1, seq2 sequence IDs
+        @return the observed distance if params->compute_obs_dist, the JC distance otherwise
+    */
+    static double computeInitialDist(PhyloTree *atree, int seq1, int seq2);
     
 	/**
 		destructor
@@ -141,4 +149,103 @@ protected:
     
 };
 
+/**
+    Maximum likelihood distances of many sequence pairs at once, for reversible
+    (non-mixture) models with discrete rate categories shared by all sites.
+    The eigen decomposition of the model is shared by all pairs: P(t) of each entry
+    is a dot product of precomputed eigen coefficients with exp(eigenvalue * t),
+    evaluated with SIMD and only for the entries observed in the pair.
+    The pairs of a batch run the same Newton-Raphson iterations as
+    Optimization::minimizeNewton() in lockstep, giving the same distances as
+    AlignmentPairwise::optimizeDist().
+*/
+class AlignmentPairwiseBatch
+{
+public:
+    /**
+        @param atree tree with the alignment, model and site rates
+    */
+    AlignmentPairwiseBatch(PhyloTree *atree);
+
+    /**
+        @param atree tree with the alignment, model and site rates
+        @return true if the distances of the tree can be computed in batches
+    */
+    static bool isApplicable(PhyloTree *atree);
+
+    /**
+        optimize the ML distances of a batch of pairs; thread-safe
+        @param npairs number of pairs
+        @param seq1 first sequence ID of each pair
+        @param seq2 second sequence ID of each pair
+        @param[in,out] dist initial guesses, replaced by the ML distances
+        @param[out] d2l second derivatives of the likelihood at the ML distances
+    */
+    void optimizeDists(size_t npairs, const int *seq1, const int *seq2, double *dist, double *d2l) const;
+
+protected:
+
+    /** state of the Newton-Raphson iterations of one pair */
+    struct NewtonState {
+        double rts, rts_old, xl, xh, dx, dxold, d2l;
+        int step;
+    };
+
+    /**
+        count the pairs of single states of two sequences, weighted by pattern frequencies
+        @param seq1, seq2 sequence IDs
+        @param[out] pair_freq num_states*num_states frequencies
+    */
+    void computePairFreq(int seq1, int seq2, double *pair_freq) const;
+
+    /**
+        compute the derivatives of the negative log-likelihood of a pair
+        @param value the distance
+        @param entries matrix entries observed in the pair
+        @param freqs frequencies of the entries
+        @param nentries number of entries
+        @param exp_sum,exp_derv1,exp_derv2 workspace of padded_states elements
+        @param[out] df,ddf first and second derivatives
+    */
+    void computeFuncDerv(double value, const int *entries, const double *freqs, size_t nentries,
+        double *exp_sum, double *exp_derv1, double *exp_derv2, double &df, double &ddf) const;
+
+    /**
+        perform one step of Optimization::minimizeNewton() after the derivatives at state.rts
+        @param[in,out] state Newton state
+        @param f,df first and second derivatives at state.rts
+        @param[out] result the optimized distance if converged
+        @return true if converged, otherwise the derivatives at state.rts are needed
+    */
+    bool updateNewton(NewtonState &state, double f, double df, double &result) const;
+
+    PhyloTree *tree;
+
+    int num_states;
+
+    /** num_states rounded up to a multiple of 4 */
+    int padded_states;
+
+    /** eigenvalues divided by the total number of substitutions, padded with zeros */
+    DoubleVector eigenvalues;
+
+    /** eigenvalues padded with zeros */
+    DoubleVector eigenvalues_derv;
+
+    /** for each matrix entry (i,j) the coefficients U(i,k)*U^-1(k,j), padded with zeros */
+    DoubleVector eigen_coeff;
+
+    /** rates of the categories, 1.0 if there is no gamma shape */
+    DoubleVector cat_rate;
+
+    /** proportions of the categories */
+    DoubleVector cat_prop;
+
+    /** proportion of invariable sites */
+    double p_invar;
+
+    /** bounds and tolerance of the distance */
+    double min_dist, max_dist;
+};
+
 #endif
@@ -0,0 +1,143 @@
+/*
+ * packedstates.cpp
+ * taxon-major packed matrix of the pattern states of an alignment
+ */
+
+#include "packedstates.h"
+#include <vectorclass/vectorclass.h>
+
+void PackedStateMatrix::build(const vector<Pattern> &patterns, size_t num_seqs, SeqType seq_type, int num_states, StateType state_unknown) {
+    clear();
+    if (seq_type == SEQ_DNA && num_states == 4 && state_unknown == 18) {
+        // DNA ambiguity states are 3 + IUPAC mask, see Alignment::convertState()
+        bits = 4;
+        decode_table.resize(16, state_unknown);
+        proper_table.resize(16, 0);
+        for (int mask = 1; mask < 16; mask++)
+            decode_table[mask] = mask + 3;
+        for (int state = 0; state < 4; state++) {
+            decode_table[1 << state] = state;
+            proper_table[1 << state] = 1;
+        }
+    } else if (state_unknown < 256) {
+        bits = 8;
+        decode_table.resize(256);
+        proper_table.resize(256, 0);
+        for (int code = 0; code < 256; code++) {
+            decode_table[code] = code;
+            proper_table[code] = (code < num_states);
+        }
+    } else
+        return;
+
+    nseq = num_seqs;
+    nptn = patterns.size();
+    this->num_states = num_states;
+    size_t bytes = (bits == 4) ? (nptn+1)/2 : nptn;
+    row_bytes = (bytes + 31) / 32 * 32;
+    uint8_t unknown_code = (bits == 4) ? 15 : state_unknown;
+    codes.resize(nseq*row_bytes, (bits == 4) ? 0xFF : unknown_code);
+    for (size_t ptn = 0; ptn < nptn; ptn++) {
+        const Pattern &pat = patterns[ptn];
+        for (size_t seq = 0; seq < nseq; seq++) {
+            StateType state = pat[seq];
+            if (state > ((bits == 4) ? state_unknown : 255)) {
+                clear();
+                return;
+            }
+            if (bits == 4) {
+                uint8_t code = (state < 4) ? (1 << state) : (state - 3);
+                uint8_t &byte = codes[seq*row_bytes + (ptn >> 1)];
+                if (ptn & 1)
+                    byte = (byte & 0x0F) | (code << 4);
+                else
+                    byte = (byte & 0xF0) | code;
+            } else
+                codes[seq*row_bytes + ptn] = state;
+        }
+    }
+}
+
+void PackedStateMatrix::clear() {
+    bits = 0;
+    nseq = 0;
+    nptn = 0;
+    row_bytes = 0;
+    num_states = 0;
+    vector<uint8_t>().swap(codes);
+    decode_table.clear();
+    proper_table.clear();
+}
+
+/**
+    add the frequencies of the patterns ptn+i for all bits i set in mask
+*/
+static inline void addPatternFreqs(uint32_t mask, size_t ptn, const vector<Pattern> &patterns, int64_t &support) {
+    while (mask) {
+        support += patterns[ptn + bit_scan_forward(mask)].frequency;
+        mask &= mask - 1;
+    }
+}
+
+/**
+    quartet supports of 16 consecutive patterns
+    @param a,b,c,d codes of the four taxa
+    @param proper patterns where all four codes are single states
+*/
+static inline void addQuartetSupports(Vec16uc const &a, Vec16uc const &b, Vec16uc const &c, Vec16uc const &d,
+    Vec16cb const &proper, size_t ptn, const vector<Pattern> &patterns, int64_t *support)
+{
+    // such patterns are always parsimony informative, no need to check the flag
+    Vec16cb ab = (a == b), cd = (c == d), ac = (a == c), bd = (b == d), ad = (a == d), bc = (b == c);
+    addPatternFreqs(to_bits(proper & ab & cd & ~ac), ptn, patterns, support[0]);
+    addPatternFreqs(to_bits(proper & ac & bd & ~ab), ptn, patterns, support[1]);
+    addPatternFreqs(to_bits(proper & ad & bc & ~ab), ptn, patterns, support[2]);
+}
+
+/** @return true for the 4-bit masks of a single state */
+static inline Vec16cb isSingleMask(Vec16uc const &mask) {
+    return (mask != Vec16uc(0)) & (Vec16uc(mask & Vec16uc(mask - Vec16uc(1))) == Vec16uc(0));
+}
+
+void PackedStateMatrix::computeQuartetSupports(const int *quartet, const vector<Pattern> &patterns, int64_t *support) const {
+    const uint8_t *row0 = getRow(quartet[0]), *row1 = getRow(quartet[1]);
+    const uint8_t *row2 = getRow(quartet[2]), *row3 = getRow(quartet[3]);
+    // padding codes are unknown, thus never proper, and rows are a multiple of 32 bytes
+    if (bits == 8) {
+        Vec16uc states(num_states);
+        for (size_t ptn = 0; ptn < nptn; ptn += 16) {
+            Vec16uc a, b, c, d;
+            a.load(row0 + ptn);
+            b.load(row1 + ptn);
+            c.load(row2 + ptn);
+            d.load(row3 + ptn);
+            Vec16cb proper = (a < states) & (b < states) & (c < states) & (d < states);
+            if (horizontal_or(proper))
+                addQuartetSupports(a, b, c, d, proper, ptn, patterns, support);
+        }
+        return;
+    }
+    ASSERT(bits == 4);
+    Vec16uc low_nibble(15);
+    for (size_t ptn = 0; ptn < nptn; ptn += 32) {
+        Vec16uc v[4];
+        v[0].load(row0 + ptn/2);
+        v[1].load(row1 + ptn/2);
+        v[2].load(row2 + ptn/2);
+        v[3].load(row3 + ptn/2);
+        // unpack the nibbles into pattern order: even patterns are in the lower nibbles
+        Vec16uc first[4], second[4];
+        for (int i = 0; i < 4; i++) {
+            Vec16uc lo = v[i] & low_nibble;
+            Vec16uc hi = v[i] >> 4;
+            first[i] = _mm_unpacklo_epi8(lo, hi);
+            second[i] = _mm_unpackhi_epi8(lo, hi);
+        }
+        Vec16cb proper = isSingleMask(first[0]) & isSingleMask(first[1]) & isSingleMask(first[2]) & isSingleMask(first[3]);
+        if (horizontal_or(proper))
+            addQuartetSupports(first[0], first[1], first[2], first[3], proper, ptn, patterns, support);
+        proper = isSingleMask(second[0]) & isSingleMask(second[1]) & isSingleMask(second[2]) & isSingleMask(second[3]);
+        if (horizontal_or(proper))
+            addQuartetSupports(second[0], second[1], second[2], second[3], proper, ptn+16, patterns, support);
+    }
+}
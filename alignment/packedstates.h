@@ -0,0 +1,145 @@
+/*
+ * packedstates.h
+ * taxon-major packed matrix of the pattern states of an alignment
+ */
+
+#ifndef PACKEDSTATES_H
+#define PACKEDSTATES_H
+
+#include "pattern.h"
+#include <stdint.h>
+#include <vector>
+
+/**
+    Pattern states of an alignment stored taxon-major: each sequence is one contiguous
+    row over all patterns, such that per-taxon scans do not visit every Pattern.
+    DNA states are packed as 4-bit IUPAC masks (A=1, C=2, G=4, T=8, unknown=15), two patterns
+    per byte, with the lower nibble for the even pattern. Other data types with all states
+    below 256 use one byte per pattern holding the state itself. Identical codes mean identical
+    states in both encodings. Rows are padded with the code of STATE_UNKNOWN to a multiple
+    of 32 bytes for vector loads.
+*/
+class PackedStateMatrix {
+public:
+
+    PackedStateMatrix() {
+        bits = 0;
+        nseq = 0;
+        nptn = 0;
+        row_bytes = 0;
+        num_states = 0;
+    }
+
+    /**
+        build the matrix from the patterns, leave it empty if the states do not fit
+        @param patterns alignment patterns
+        @param num_seqs number of sequences
+        @param seq_type data type
+        @param num_states number of states
+        @param state_unknown state of a gap or unknown character
+    */
+    void build(const vector<Pattern> &patterns, size_t num_seqs, SeqType seq_type, int num_states, StateType state_unknown);
+
+    /** release all memory */
+    void clear();
+
+    /** @return true if the matrix is not built */
+    bool empty() const {
+        return bits == 0;
+    }
+
+    /** @return 4 for DNA masks, 8 for states as bytes, 0 if empty */
+    int getBits() const {
+        return bits;
+    }
+
+    /** @return number of sequences */
+    size_t getNSeq() const {
+        return nseq;
+    }
+
+    /** @return number of patterns */
+    size_t getNPattern() const {
+        return nptn;
+    }
+
+    /** @return number of bytes per row including padding */
+    size_t getRowBytes() const {
+        return row_bytes;
+    }
+
+    /**
+        @param seq sequence ID
+        @return packed codes of the sequence over all patterns
+    */
+    const uint8_t *getRow(size_t seq) const {
+        return &codes[seq*row_bytes];
+    }
+
+    /**
+        @param seq sequence ID
+        @param ptn pattern ID
+        @return code of the state
+    */
+    inline uint8_t getCode(size_t seq, size_t ptn) const {
+        if (bits == 4)
+            return (codes[seq*row_bytes + (ptn >> 1)] >> ((ptn & 1) << 2)) & 15;
+        return codes[seq*row_bytes + ptn];
+    }
+
+    /**
+        @param seq sequence ID
+        @param ptn pattern ID
+        @return state as in the Pattern
+    */
+    inline StateType getState(size_t seq, size_t ptn) const {
+        return decode_table[getCode(seq, ptn)];
+    }
+
+    /**
+        @param code code of a state
+        @return true if the code is a single state, i.e. not ambiguous nor unknown
+    */
+    inline bool isProper(uint8_t code) const {
+        return proper_table[code] != 0;
+    }
+
+    /**
+        count the patterns supporting each quartet topology 01|23, 02|13 and 03|12,
+        i.e. both pairs share a single state that differs between the pairs.
+        Compares 16 patterns at a time with SIMD.
+        @param quartet four sequence IDs
+        @param patterns the patterns the matrix was built from, for the frequencies
+        @param[in,out] support the three supports, incremented by the pattern frequencies
+    */
+    void computeQuartetSupports(const int *quartet, const vector<Pattern> &patterns, int64_t *support) const;
+
+protected:
+
+    /** 4, 8 or 0 if empty */
+    int bits;
+
+    /** number of sequences */
+    size_t nseq;
+
+    /** number of patterns */
+    size_t nptn;
+
+    /** number of bytes per row */
+    size_t row_bytes;
+
+    /** number of states, codes below are single states in the 8-bit encoding */
+    int num_states;
+
+    /** codes of all rows */
+    vector<uint8_t> codes;
+
+    /** state of each code */
+    vector<StateType> decode_table;
+
+    /** 1 if a code is a single state, 0 otherwise */
+    vector<uint8_t> proper_table;
+
+};
+
+#endif
@@ -102,33 +102,139 @@ void printOptions(FILE * out,char* input_tree,char * boot_trees, char * output_t
   fprintf(out,"**************************\n");
 }
 */
-void reset_matrices(int nb_taxa, int nb_edges_ref, int nb_edges_boot, short unsigned*** c_matrix, short unsigned*** i_matrix, short unsigned*** hamming, short unsigned** min_dist, short unsigned** min_dist_edges){
+/* Work space of one thread for the transfer distances between the reference tree and one bootstrap tree.
+   The sizes of the intersections between the reference clusters and the cluster below a bootstrap edge form
+   one column of nb_edges ints per bootstrap edge. The post-order traversal of the bootstrap tree computes the
+   column of the heaviest child in place of its parent's column, so that only O(log n) columns are alive at
+   any time instead of the nb_edges_ref x nb_edges_boot matrices. */
+typedef struct __TransferWorkspace {
+  Tree* ref_tree;
+  map_t taxid_map;	/* taxon name -> taxon id */
+  int* ref_leaf_edge;	/* terminal edge of the reference tree of each taxon */
+  int* ref_parent_edge;	/* edge above each edge of the reference tree, -1 at the root */
+  int** columns;	/* intersection sizes, one column per level of light children */
+  int nb_levels;
+  int* boot_rank;	/* post-order rank of each bootstrap edge, to break ties as the matrix version */
+  int* boot_size;	/* number of taxa below each bootstrap edge */
+  int nb_boot_edges;	/* allocated size of boot_rank and boot_size */
+  int* min_dist;	/* min transfer distance of each reference edge */
+  int* min_dist_edge;	/* bootstrap edge reaching it */
+  int* min_rank;	/* post-order rank of that bootstrap edge */
+} TransferWorkspace;
+
+void init_transfer_workspace(TransferWorkspace* ws, Tree* ref_tree, map_t taxid_map, int* ref_leaf_edge, int* ref_parent_edge) {
+  int m = ref_tree->nb_edges;
+  ws->ref_tree = ref_tree;
+  ws->taxid_map = taxid_map;
+  ws->ref_leaf_edge = ref_leaf_edge;
+  ws->ref_parent_edge = ref_parent_edge;
+  /* a light child has at most half of the taxa of its parent */
+  for (ws->nb_levels = 2; (1 << (ws->nb_levels - 2)) <= ref_tree->nb_taxa; ws->nb_levels++);
+  ws->columns = (int**) calloc(ws->nb_levels, sizeof(int*));
+  ws->boot_rank = NULL;
+  ws->boot_size = NULL;
+  ws->nb_boot_edges = 0;
+  ws->min_dist = (int*) malloc(m*sizeof(int));
+  ws->min_dist_edge = (int*) malloc(m*sizeof(int));
+  ws->min_rank = (int*) malloc(m*sizeof(int));
+}
+
+void free_transfer_workspace(TransferWorkspace* ws) {
   int i;
-  (*min_dist) = (short unsigned*) malloc(nb_edges_ref*sizeof(short unsigned)); /* array of min Hamming distances */
-  (*min_dist_edges) = (short unsigned*) malloc(nb_edges_ref*sizeof(short unsigned)); /* array of edge ids corresponding to min Hamming distances */
-  (*c_matrix) = (short unsigned**) malloc(nb_edges_ref*sizeof(short unsigned*)); /* matrix of cardinals of complements */
-  (*i_matrix) = (short unsigned**) malloc(nb_edges_ref*sizeof(short unsigned*)); /* matrix of cardinals of intersections */
-  (*hamming) = (short unsigned**) malloc(nb_edges_ref*sizeof(short unsigned*)); /* matrix of Hamming distances */
-  for (i=0; i<nb_edges_ref; i++){
-    (*c_matrix)[i] = (short unsigned*) malloc(nb_edges_boot*sizeof(short unsigned));
-    (*i_matrix)[i] = (short unsigned*) malloc(nb_edges_boot*sizeof(short unsigned));
-    (*hamming)[i] = (short unsigned*) malloc(nb_edges_boot*sizeof(short unsigned));
-    (*min_dist)[i] = nb_taxa; /* initialization to the nb of taxa */
+  for (i = 0; i < ws->nb_levels; i++) free(ws->columns[i]);
+  free(ws->columns);
+  free(ws->boot_rank);
+  free(ws->boot_size);
+  free(ws->min_dist);
+  free(ws->min_dist_edge);
+  free(ws->min_rank);
+}
+
+int rank_boot_edges_post_order(TransferWorkspace* ws, Node* orig, Node* target, int next_rank) {
+  /* numbers the edges of the bootstrap tree in the order of update_i_c_post_order_boot_tree and counts the taxa below them */
+  int j, dir, target_to_orig = dir_a_to_b(target, orig);
+  int edge_id = orig->br[dir_a_to_b(orig, target)]->id;
+  ws->boot_size[edge_id] = (target->nneigh == 1);
+  for (j = 1; j < target->nneigh; j++) {
+    dir = (target_to_orig + j) % target->nneigh;
+    next_rank = rank_boot_edges_post_order(ws, target, target->neigh[dir], next_rank);
+    ws->boot_size[edge_id] += ws->boot_size[target->br[dir]->id];
   }
+  ws->boot_rank[edge_id] = next_rank;
+  return next_rank + 1;
 }
 
-void free_matrices(int nb_edges_ref, short unsigned*** c_matrix, short unsigned*** i_matrix, short unsigned*** hamming, short unsigned** min_dist, short unsigned** min_dist_edges){
-  int i;
-  for (i=0; i<nb_edges_ref; i++) {
-    free((*c_matrix)[i]);
-    free((*i_matrix)[i]);
-    free((*hamming)[i]);
-  }
-  free((*c_matrix));
-  free((*i_matrix));
-  free((*hamming));
-  free((*min_dist));
-  free((*min_dist_edges));
+void update_transfer_column(TransferWorkspace* ws, Node* orig, Node* target, int* column, int level) {
+  /* computes into column the sizes of the intersections of all the reference clusters with the cluster below
+     the bootstrap edge from orig to target, and updates the min transfer distances with that edge */
+  int i, j, dir, heavy_dir;
+  int m = ws->ref_tree->nb_edges;
+  int N = ws->ref_tree->nb_taxa;
+  int edge_id = orig->br[dir_a_to_b(orig, target)]->id;
+  int size = ws->boot_size[edge_id], rank = ws->boot_rank[edge_id];
+
+  if (target->nneigh == 1) {
+    int* taxon_id;
+    if (hashmap_get(ws->taxid_map, target->name, (any_t*)&taxon_id) != MAP_OK) {
+      fprintf(stderr,"Taxon %s of the bootstrap tree is not in the reference tree. Aborting.\n", target->name);
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__,EXIT_FAILURE);
+    }
+    memset(column, 0, m*sizeof(int));
+    for (i = ws->ref_leaf_edge[*taxon_id]; i >= 0; i = ws->ref_parent_edge[i]) column[i] = 1;
+  } else {
+    int target_to_orig = dir_a_to_b(target, orig);
+    heavy_dir = -1;
+    for (j = 1; j < target->nneigh; j++) {
+      dir = (target_to_orig + j) % target->nneigh;
+      if (heavy_dir < 0 || ws->boot_size[target->br[dir]->id] > ws->boot_size[target->br[heavy_dir]->id]) heavy_dir = dir;
+    }
+    update_transfer_column(ws, target, target->neigh[heavy_dir], column, level);
+    for (j = 1; j < target->nneigh; j++) {
+      dir = (target_to_orig + j) % target->nneigh;
+      if (dir == heavy_dir) continue;
+      assert(level+1 < ws->nb_levels);
+      if (ws->columns[level+1] == NULL) ws->columns[level+1] = (int*) malloc(m*sizeof(int));
+      int* child_column = ws->columns[level+1];
+      update_transfer_column(ws, target, target->neigh[dir], child_column, level+1);
+      for (i = 0; i < m; i++) column[i] += child_column[i];
+    }
+  }
+
+  for (i = 0; i < m; i++) {
+    /* card of union minus card of intersection, then min (dist, N-dist) */
+    int h = ws->ref_tree->a_edges[i]->hashtbl[1]->num_items + size - 2*column[i];
+    if (h > N/2) h = N - h;
+    if (h < ws->min_dist[i] || (h == ws->min_dist[i] && rank < ws->min_rank[i])) {
+      ws->min_dist[i] = h;
+      ws->min_dist_edge[i] = edge_id;
+      ws->min_rank[i] = rank;
+    }
+  }
+}
+
+void compute_min_transfer_distances(TransferWorkspace* ws, Tree* boot_tree) {
+  /* for all edges of the reference tree, the min transfer distance to an edge of boot_tree */
+  int i, next_rank = 0;
+  Node* root = boot_tree->node0;
+  if (boot_tree->nb_edges > ws->nb_boot_edges) {
+    ws->nb_boot_edges = boot_tree->nb_edges;
+    ws->boot_rank = (int*) realloc(ws->boot_rank, ws->nb_boot_edges*sizeof(int));
+    ws->boot_size = (int*) realloc(ws->boot_size, ws->nb_boot_edges*sizeof(int));
+  }
+  for (i = 0; i < ws->ref_tree->nb_edges; i++) {
+    ws->min_dist[i] = ws->ref_tree->nb_taxa;
+    ws->min_dist_edge[i] = -1;
+    ws->min_rank[i] = boot_tree->nb_edges;
+  }
+  for (i = 0; i < root->nneigh; i++) next_rank = rank_boot_edges_post_order(ws, root, root->neigh[i], next_rank);
+  if (ws->columns[0] == NULL) ws->columns[0] = (int*) malloc(ws->ref_tree->nb_edges*sizeof(int));
+  for (i = 0; i < root->nneigh; i++) update_transfer_column(ws, root, root->neigh[i], ws->columns[0], 0);
+
+  for (i = 0; i < ws->ref_tree->nb_edges; i++) {
+    assert(ws->min_dist[i] >= 0);
+    if(ws->ref_tree->a_edges[i]->right->nneigh == 1)
+      assert(ws->min_dist[i] == 0); /* any terminal edge should have an exact match in any bootstrap tree */
+  }
 }
 
 int main_booster (const char* input_tree, const char *boot_trees,
@@ -413,23 +519,19 @@ void fbp(Tree *ref_tree, char **alt_tree_strings,char** taxname_lookup_table, in
 }
 
 void tbe(Tree *ref_tree, Tree *ref_raw_tree, char **alt_tree_strings,char** taxname_lookup_table, FILE *stat_file, int num_trees, int quiet, double dist_cutoff, int count_per_branch){
-  short unsigned** c_matrix;
-  short unsigned** i_matrix;
-  short unsigned** hamming;
-  short unsigned* min_dist_edge; /* array of edge ids corresponding to min Hamming distances */
-  short unsigned* min_dist;
   int i,j;
   int m = ref_tree->nb_edges;
   int n = ref_tree->nb_taxa;
-  Tree *alt_tree;
   int i_tree;
   int *dist_accu      = (int*) calloc(m,sizeof(int)); /* array of distance sums, one per branch. Initialized to 0. */
-  int **dist_accu_tmp;
   double *moved_species_counts;  /* array of average branch rate in which each taxon moves */
-  int *moved_species; /* array of number of branches in which each taxon moves, in one bootstrap tree: initialized at each bootstrap tree */
-  /** Max number of branches we can see in the bootstrap tree: If it has no multifurcation : binary tree--> ntax*2-2 (if rooted...) */
-  int max_branches_boot = ref_tree->nb_taxa*2-2;
-  
+  int nb_threads = 1;
+  int **dist_accu_thread;  /* per-thread distance sums, merged into dist_accu at the end */
+  double **moved_species_counts_thread;
+  map_t taxid_map = build_taxid_hashmap(taxname_lookup_table, n);
+  int *ref_leaf_edge = (int*) malloc(n*sizeof(int));
+  int *ref_parent_edge = (int*) malloc(m*sizeof(int));
+
   /* array a[i][j] of number of bootstrap tree from which each taxon j moves around the branch i and that are closer than given distance */
   int **moved_species_counts_per_branch;
 
@@ -439,16 +541,45 @@ void tbe(Tree *ref_tree, Tree *ref_raw_tree, char **alt_tree_strings,char** taxn
       moved_species_counts_per_branch[i]  = (int*) calloc(n,sizeof(int));
     }
   }
-  dist_accu_tmp = (int**) calloc(num_trees,sizeof(int*)); /* array of distance sums, one per boot tree and branch. Initialized to 0. */
-  for(i_tree=0; i_tree< num_trees; i_tree++){
-    dist_accu_tmp[i_tree]  = (int*) calloc(m,sizeof(int)); /* array of distance sums, one per branch. Initialized to 0. */
-  }
   moved_species_counts = (double*) calloc(m,sizeof(double)); /* array of average branch rate in which each taxon moves */
 
-#pragma omp parallel for private(min_dist,c_matrix,i_matrix,hamming,min_dist_edge, i, alt_tree, moved_species) shared(max_branches_boot, ref_tree, alt_tree_strings, dist_accu_tmp, taxname_lookup_table, m, moved_species_counts, moved_species_counts_per_branch) schedule(dynamic)
+  /* parent edges and leaf edges of the reference tree, the right side of an edge is its descendant */
+  for(i=0;i<m;i++) ref_parent_edge[i] = -1;
+  for(i=0;i<m;i++){
+    Node* child = ref_tree->a_edges[i]->right;
+    if(child->nneigh == 1){
+      int* taxon_id;
+      hashmap_get(taxid_map, child->name, (any_t*)&taxon_id);
+      ref_leaf_edge[*taxon_id] = i;
+    }
+    for(j=0;j<child->nneigh;j++)
+      if(child->br[j] != ref_tree->a_edges[i]) ref_parent_edge[child->br[j]->id] = i;
+  }
+
+#ifdef _OPENMP
+  nb_threads = omp_get_max_threads();
+#endif
+  dist_accu_thread = (int**) malloc(nb_threads*sizeof(int*));
+  moved_species_counts_thread = (double**) malloc(nb_threads*sizeof(double*));
+  for(i=0;i<nb_threads;i++){
+    dist_accu_thread[i] = (int*) calloc(m,sizeof(int));
+    moved_species_counts_thread[i] = (double*) calloc(n,sizeof(double));
+  }
+
+#pragma omp parallel private(i,j,i_tree) num_threads(nb_threads)
+  {
+  int thread_id = 0;
+#ifdef _OPENMP
+  thread_id = omp_get_thread_num();
+#endif
+  TransferWorkspace ws;
+  int *moved_species = (int*) malloc(n*sizeof(int)); /* array of number of branches in which each taxon moves, in one bootstrap tree: reset at each bootstrap tree */
+  init_transfer_workspace(&ws, ref_tree, taxid_map, ref_leaf_edge, ref_parent_edge);
+
+#pragma omp for schedule(dynamic)
   for(i_tree=0; i_tree< num_trees; i_tree++){
     if(!quiet) fprintf(stderr,"New bootstrap tree : %d\n",i_tree);
-    alt_tree = complete_parse_nh(alt_tree_strings[i_tree], &taxname_lookup_table);
+    Tree *alt_tree = complete_parse_nh(alt_tree_strings[i_tree], &taxname_lookup_table);
     
     if (alt_tree == NULL) {
       fprintf(stderr,"Not a correct NH tree (%d). Skipping.\n%s\n",i_tree,alt_tree_strings[i_tree]);
@@ -459,30 +590,23 @@ void tbe(Tree *ref_tree, Tree *ref_raw_tree, char **alt_tree_strings,char** taxn
       continue; /* some files maybe not containing trees */
     }
 
-    /* resetting the arrays that need be reset. By construction of the post-order traversal,
-       the other arrays (i_matrix, c_matrix and hamming) need not be reset. */
-    reset_matrices(n, m, max_branches_boot, &c_matrix, &i_matrix, &hamming, &min_dist,&min_dist_edge);
-
     /****************************************************/
     /* comparison of the bipartitions, Transfer method */
     /****************************************************/		  
-    /* calculation of the C and I matrices (see Brehelin/Gascuel/Martin) */
-    update_all_i_c_post_order_ref_tree(ref_tree, alt_tree, i_matrix, c_matrix);
-    update_all_i_c_post_order_boot_tree(ref_tree, alt_tree, i_matrix, c_matrix, hamming, min_dist, min_dist_edge);
+    compute_min_transfer_distances(&ws, alt_tree);
 
     /* Looking at number of times each taxon moves around low distance branches */
-    moved_species = (int*) calloc(n,sizeof(int));
+    memset(moved_species, 0, n*sizeof(int));
     int nb_branches_close=0;
-    int j;
     for(i=0;i<m;i++){
       Edge* re = ref_tree->a_edges[i];
       if (re->right->nneigh == 1) continue;
-      Edge* be = alt_tree->a_edges[min_dist_edge[i]];
+      Edge* be = alt_tree->a_edges[ws.min_dist_edge[i]];
 
-      double norm  = ((double)min_dist[i]) * 1.0 / (((double)re->topo_depth) - 1.0);
+      double norm  = ((double)ws.min_dist[i]) * 1.0 / (((double)re->topo_depth) - 1.0);
       int mindepth = (int)(ceil(1.0/dist_cutoff + 1.0));
-      int* sm = species_to_move(re, be, min_dist[i], n);
-      for(j=0;j<min_dist[i];j++){
+      int* sm = species_to_move(re, be, ws.min_dist[i], n);
+      for(j=0;j<ws.min_dist[i];j++){
 	if (norm <= dist_cutoff && re->topo_depth >= mindepth ){
 	  moved_species[sm[j]]++;
 	}
@@ -497,28 +621,32 @@ void tbe(Tree *ref_tree, Tree *ref_raw_tree, char **alt_tree_strings,char** taxn
       free(sm);
     }
 
-    /* output, just to see */
     for (i = 0; i < m; i++) {
-      /* Just backup for pvalue computation */
-      dist_accu_tmp[i_tree][i] = min_dist[i];
+      dist_accu_thread[thread_id][i] += ws.min_dist[i];
     }
     for (i=0; i < n; i++){
-      #pragma omp atomic update
-      moved_species_counts[i] += ((double)moved_species[i])*1.0/((double)nb_branches_close);
+      moved_species_counts_thread[thread_id][i] += ((double)moved_species[i])*1.0/((double)nb_branches_close);
     }
 
-    free_matrices(m, &c_matrix, &i_matrix, &hamming, &min_dist,&min_dist_edge);
     free_tree(alt_tree);
-    free(moved_species);
   }
 
-  #pragma omp barrier
+  free(moved_species);
+  free_transfer_workspace(&ws);
+  }
 
-  for (i = 0; i < m; i++){
-    for(i_tree=0; i_tree < num_trees; i_tree++){
-      dist_accu[i] += dist_accu_tmp[i_tree][i];
-    }
+  /* merging the per-thread sums in thread order */
+  for(i_tree=0; i_tree < nb_threads; i_tree++){
+    for (i = 0; i < m; i++) dist_accu[i] += dist_accu_thread[i_tree][i];
+    for (i = 0; i < n; i++) moved_species_counts[i] += moved_species_counts_thread[i_tree][i];
+    free(dist_accu_thread[i_tree]);
+    free(moved_species_counts_thread[i_tree]);
   }
+  free(dist_accu_thread);
+  free(moved_species_counts_thread);
+  free(ref_leaf_edge);
+  free(ref_parent_edge);
+  free_taxid_hashmap(taxid_map);
 
   double bootstrap_val, avg_dist;
 		
@@ -581,10 +709,6 @@ void tbe(Tree *ref_tree, Tree *ref_raw_tree, char **alt_tree_strings,char** taxn
   }
   
   free(dist_accu);
-  for(i_tree=0; i_tree < num_trees;i_tree++){
-    free(dist_accu_tmp[i_tree]);
-  }
-  free(dist_accu_tmp);
   free(moved_species_counts);
 }
 
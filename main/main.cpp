@@ -1265,22 +1265,51 @@ void calcDistribution(Params &params) {
     }
 }
 
-void printRFDist(string filename, double *rfdist, int n, int m, int rf_dist_mode, bool print_msg = true) {
+/**
+    print the CSV header of a Robinson-Foulds distance file
+*/
+void printRFDistCSVHeader(ostream &out, string filename) {
+    out << "# Robinson-Foulds distances" << endl
+    << "# This file can be read in MS Excel or in R with command:" << endl
+    << "#    dat=read.csv('" <<  filename << "',comment.char='#')" << endl
+    << "# Columns are comma-separated with following meanings:" << endl
+    << "#    ID1:     Tree 1 ID" << endl
+    << "#    ID2:     Tree 2 ID" << endl
+    << "#    Dist:    Robinson-Foulds distance" << endl
+    << "ID1,ID2,Dist" << endl;
+}
+
+/**
+    print rows of an all-pairs Robinson-Foulds distance matrix
+    @param rfdist num_rows * m distances
+    @param first_row ID of the first row
+*/
+void printRFDistRows(ostream &out, double *rfdist, int first_row, int num_rows, int m) {
     int i, j;
+    if (Params::getInstance().output_format == FORMAT_CSV) {
+        for (i = 0; i < num_rows; i++)  {
+            for (j = 0; j < m; j++)
+                out << first_row+i+1 << ',' << j+1 << ',' << rfdist[i*m+j] << endl;
+        }
+    } else {
+        for (i = 0; i < num_rows; i++)  {
+            out << "Tree" << first_row+i << "      ";
+            for (j = 0; j < m; j++)
+                out << " " << rfdist[i*m+j];
+            out << endl;
+        }
+    }
+}
+
+void printRFDist(string filename, double *rfdist, int n, int m, int rf_dist_mode, bool print_msg = true) {
+    int i;
 
     try {
         ofstream out;
         out.exceptions(ios::failbit | ios::badbit);
         out.open(filename);
         if (Params::getInstance().output_format == FORMAT_CSV) {
-            out << "# Robinson-Foulds distances" << endl
-            << "# This file can be read in MS Excel or in R with command:" << endl
-            << "#    dat=read.csv('" <<  filename << "',comment.char='#')" << endl
-            << "# Columns are comma-separated with following meanings:" << endl
-            << "#    ID1:     Tree 1 ID" << endl
-            << "#    ID2:     Tree 2 ID" << endl
-            << "#    Dist:    Robinson-Foulds distance" << endl
-            << "ID1,ID2,Dist" << endl;
+            printRFDistCSVHeader(out, filename);
             if (rf_dist_mode == RF_ADJACENT_PAIR) {
                 for (i = 0; i < n; i++)
                     out << i+1 << ',' << i+2 << ',' << rfdist[i] << endl;
@@ -1288,10 +1317,7 @@ void printRFDist(string filename, double *rfdist, int n, int m, int rf_dist_mode
                 for (i = 0; i < n; i++)
                     out << i+1 << ',' << i+1 << ',' << rfdist[i] << endl;
             } else {
-                for (i = 0; i < n; i++)  {
-                    for (j = 0; j < m; j++)
-                        out << i+1 << ',' << j+1 << ',' << rfdist[i*m+j] << endl;
-                }
+                printRFDistRows(out, rfdist, 0, n, m);
             }
         } else if (rf_dist_mode == RF_ADJACENT_PAIR || Params::getInstance().rf_same_pair) {
             out << "XXX        ";
@@ -1302,12 +1328,7 @@ void printRFDist(string filename, double *rfdist, int n, int m, int rf_dist_mode
         } else {
             // all pairs
             out << n << " " << m << endl;
-            for (i = 0; i < n; i++)  {
-                out << "Tree" << i << "      ";
-                for (j = 0; j < m; j++)
-                    out << " " << rfdist[i*m+j];
-                out << endl;
-            }
+            printRFDistRows(out, rfdist, 0, n, m);
         }
         out.close();
         if (print_msg)
@@ -1317,6 +1338,50 @@ void printRFDist(string filename, double *rfdist, int n, int m, int rf_dist_mode
     }
 }
 
+/**
+    compute the Robinson-Foulds distances between all pairs of trees, or between two
+    tree sets, on one index of the distinct splits of all trees. Blocks of rows are
+    computed in parallel and printed to the file as soon as they are done, such that
+    the full distance matrix is never stored.
+    @param trees first tree set
+    @param treeset2 second tree set, NULL for all pairs of the first tree set
+    @param weight_threshold minimum weight of the splits counted (all pairs only)
+*/
+void computeRFDistIndexed(string filename, MTreeSet &trees, MTreeSet *treeset2, double weight_threshold) {
+    int n = trees.size();
+    int m = treeset2 ? treeset2->size() : n;
+    TreeSplitIndex index;
+    trees.buildSplitIndex(index, treeset2 ? -numeric_limits<double>::infinity() : weight_threshold, treeset2);
+    if (verbose_mode >= VB_MED)
+        cout << index.splits.size() << " distinct splits in " << index.tree_splits.size() << " trees" << endl;
+    int first_col = treeset2 ? n : 0;
+    bool normalize = treeset2 && Params::getInstance().normalize_tree_dist;
+#ifdef _OPENMP
+    int block_rows = 16 * omp_get_max_threads();
+#else
+    int block_rows = 16;
+#endif
+    DoubleVector rfdist((size_t)min(block_rows, n) * m);
+    try {
+        ofstream out;
+        out.exceptions(ios::failbit | ios::badbit);
+        out.open(filename);
+        if (Params::getInstance().output_format == FORMAT_CSV)
+            printRFDistCSVHeader(out, filename);
+        else
+            out << n << " " << m << endl;
+        for (int first_row = 0; first_row < n; first_row += block_rows) {
+            int num_rows = min(block_rows, n - first_row);
+            MTreeSet::computeRFDistRows(index, first_row, num_rows, first_col, m, normalize, rfdist.data());
+            printRFDistRows(out, rfdist.data(), first_row, num_rows, m);
+        }
+        out.close();
+        cout << "Robinson-Foulds distances printed to " << filename << endl;
+    } catch (ios::failure) {
+        outError(ERR_WRITE_OUTPUT, filename);
+    }
+}
+
 void computeRFDistExtended(const char *trees1, const char *trees2, const char *filename) {
     cout << "Reading input trees 1 file " << trees1 << endl;
     int ntrees = 0, ntrees2 = 0;
@@ -1429,6 +1494,18 @@ void computeRFDist(Params &params) {
 
     MTreeSet trees(params.user_file, params.is_rooted, params.tree_burnin, params.tree_max_count);
     int n = trees.size(), m = trees.size();
+    // the detailed split information of the verbose modes needs the per-tree split maps
+    if (verbose_mode < VB_MED && params.rf_dist_mode == RF_ALL_PAIR && n >= 2) {
+        cout << "Computing Robinson-Foulds distance..." << endl;
+        computeRFDistIndexed(filename, trees, NULL, params.split_weight_threshold);
+        return;
+    }
+    if (verbose_mode < VB_MED && params.rf_dist_mode == RF_TWO_TREE_SETS) {
+        MTreeSet treeset2(params.second_tree, params.is_rooted, params.tree_burnin, params.tree_max_count);
+        cout << "Computing Robinson-Foulds distances between two sets of trees" << endl;
+        computeRFDistIndexed(filename, trees, &treeset2, params.split_weight_threshold);
+        return;
+    }
     double *rfdist;
     double *incomp_splits = NULL;
     string infoname = params.out_prefix;
@@ -2274,6 +2351,9 @@ int main(int argc, char *argv[]) {
     Checkpoint *checkpoint = new Checkpoint;
     string filename = (string)Params::getInstance().out_prefix +".ckp.gz";
     checkpoint->setFileName(filename);
+    checkpoint->setAsyncDump(Params::getInstance().checkpoint_async);
+    checkpoint->setJournal(Params::getInstance().checkpoint_journal);
+    checkpoint->setBinaryArrays(Params::getInstance().checkpoint_journal);
     
     bool append_log = false;
     
@@ -12,6 +12,7 @@
 #endif
 #include <iqtree_config.h>
 #include <numeric>
+#include <functional>
 #include "tree/phylotree.h"
 #include "tree/iqtree.h"
 #include "tree/phylosupertree.h"
@@ -779,6 +780,117 @@ void transferModelFinderParameters(IQTree *iqtree, Checkpoint *target) {
     source->transferSubCheckpoint(target, "PhyloTree");
 }
 
+#ifdef _IQTREE_MPI
+/**
+ distribute ModelFinder tasks over MPI processes with dynamic load balancing.
+ The master sends the tasks in decreasing order of estimated cost to idle workers and
+ collects the returned checkpoints into model_info, which is finally broadcast to all processes.
+ The subsequent sequential model selection then restores all results from model_info.
+ @param tasks list of (task ID, estimated cost), only needed for the master
+ @param model_info (IN/OUT) model checkpoint
+ @param evaluate_task function to compute a task ID and store the results into a checkpoint
+ */
+void distributeModelTasks(vector<pair<int,double> > tasks, ModelCheckpoint &model_info,
+                          function<void(int, ModelCheckpoint&)> evaluate_task)
+{
+    MPIHelper &mpi = MPIHelper::getInstance();
+    string msg;
+    if (mpi.isMaster()) {
+        // longest tasks first
+        std::stable_sort(tasks.begin(), tasks.end(),
+            [](const pair<int,double> &a, const pair<int,double> &b) { return a.second > b.second; });
+        size_t next_task = 0;
+        int num_running = 0;
+        int num_done = 0;
+        // give one task to each worker, -1 means no more task
+        for (int proc = 1; proc < mpi.getNumProcesses(); proc++) {
+            msg = (next_task < tasks.size()) ? convertIntToString(tasks[next_task++].first) : "-1";
+            if (msg != "-1")
+                num_running++;
+            mpi.sendString(msg, proc, MODEL_TAG);
+        }
+        while (num_running > 0) {
+            ModelCheckpoint task_info;
+            int proc = mpi.recvCheckpoint(&task_info);
+            num_running--;
+            num_done++;
+            model_info.putSubCheckpoint(&task_info, "");
+            model_info.dump();
+            if (verbose_mode >= VB_MED)
+                cout << "ModelFinder task " << num_done << "/" << tasks.size() << " done by process " << proc << endl;
+            msg = (next_task < tasks.size()) ? convertIntToString(tasks[next_task++].first) : "-1";
+            if (msg != "-1")
+                num_running++;
+            mpi.sendString(msg, proc, MODEL_TAG);
+        }
+    } else {
+        while (true) {
+            mpi.recvString(msg, PROC_MASTER, MODEL_TAG);
+            int task = convert_int(msg.c_str());
+            if (task < 0)
+                break;
+            ModelCheckpoint task_info;
+            evaluate_task(task, task_info);
+            mpi.sendCheckpoint(&task_info, PROC_MASTER);
+        }
+    }
+    mpi.broadcastCheckpoint(&model_info);
+}
+
+/**
+ @return relative cost of evaluating a candidate model, proportional to the number of rate categories
+ */
+double estimateModelCost(Params &params, CandidateModel &model) {
+    string &rate_name = model.rate_name;
+    double ncat = 1.0;
+    size_t pos;
+    if ((pos = rate_name.find("+G")) != string::npos) {
+        ncat = params.num_rate_cats;
+        if (pos+2 < rate_name.length() && isdigit(rate_name[pos+2]))
+            ncat = atoi(rate_name.c_str()+pos+2);
+    }
+    if ((pos = rate_name.find("+R")) != string::npos && pos+2 < rate_name.length()) {
+        // FreeRate needs more optimization rounds than Gamma
+        ncat = 2.0 * atoi(rate_name.c_str()+pos+2);
+    }
+    if (rate_name.find("+I") != string::npos)
+        ncat += 1.0;
+    return ncat;
+}
+
+/**
+ evaluate the candidate models of a single alignment over MPI processes
+ */
+void evaluateModelsMPI(Params &params, IQTree &iqtree, ModelCheckpoint &model_info,
+                       ModelsBlock *models_block, int num_threads)
+{
+    CandidateModelSet candidates;
+    candidates.generate(params, iqtree.aln, params.model_test_separate_rate, false);
+    vector<pair<int,double> > tasks;
+    for (int model = 0; model < candidates.size(); model++) {
+        // rate models tested separately depend on the best substitution model
+        if (candidates[model].subst_name.empty())
+            continue;
+        // already restored from .model.gz
+        if (model_info.hasKey(candidates[model].getName()))
+            continue;
+        tasks.push_back({model, estimateModelCost(params, candidates[model])});
+    }
+    if (MPIHelper::getInstance().isMaster())
+        cout << "Distributing " << tasks.size() << " models over " << MPIHelper::getInstance().getNumProcesses()-1
+             << " MPI worker processes..." << endl;
+    distributeModelTasks(tasks, model_info, [&](int model, ModelCheckpoint &task_info) {
+        ModelCheckpoint out_model_info;
+        int task_threads = num_threads;
+        // keep the tree to restore the best tree of the model selection
+        candidates[model].tree = candidates[model].evaluate(params, model_info, out_model_info,
+            models_block, task_threads, BRLEN_OPTIMIZE);
+        task_info.putSubCheckpoint(&out_model_info, "");
+        candidates[model].saveCheckpoint(&task_info);
+    });
+}
+#endif
+
 void runModelFinder(Params &params, IQTree &iqtree, ModelCheckpoint &model_info, string &best_subst_name, string &best_rate_name)
 {
     if (params.model_name.find("+T") != string::npos) {
@@ -808,8 +920,8 @@ void runModelFinder(Params &params, IQTree &iqtree, ModelCheckpoint &model_info,
     // Model already specifed, nothing to do here
     if (!empty_model_found && params.model_name.substr(0, 4) != "TEST" && params.model_name.substr(0, 2) != "MF")
         return;
-    if (MPIHelper::getInstance().getNumProcesses() > 1)
-        outError("Please use only 1 MPI process! We are currently working on the MPI parallelization of model selection.");
+    if (MPIHelper::getInstance().getNumProcesses() > 1 && params.model_test_and_tree)
+        outError("Please use only 1 MPI process for ModelFinder with tree search per model!");
     // TODO: check if necessary
     //        if (iqtree.isSuperTree())
     //            ((PhyloSuperTree*) &iqtree)->mapTrees();
@@ -819,9 +931,12 @@ void runModelFinder(Params &params, IQTree &iqtree, ModelCheckpoint &model_info,
     model_info.setDumpInterval(params.checkpoint_dump_interval);
     
     bool ok_model_file = false;
-    if (!params.model_test_again) {
+    if (!params.model_test_again && MPIHelper::getInstance().isMaster()) {
         ok_model_file = model_info.load();
     }
+    // only the master writes .model.gz
+    if (MPIHelper::getInstance().isWorker())
+        model_info.setFileName("");
     
     cout << endl;
     
@@ -873,6 +988,14 @@ void runModelFinder(Params &params, IQTree &iqtree, ModelCheckpoint &model_info,
     //        iqtree.saveCheckpoint();
     //        checkpoint->dump(true);
     
+#ifdef _IQTREE_MPI
+    if (MPIHelper::getInstance().getNumProcesses() > 1) {
+        // all processes start from the initial tree and model information of the master
+        MPIHelper::getInstance().broadcastCheckpoint(&model_info);
+        iqtree.restoreCheckpoint();
+    }
+#endif
+
     CandidateModelSet candidate_models;
     int max_cats = candidate_models.generate(params, iqtree.aln, params.model_test_separate_rate, false);
     
@@ -901,6 +1024,10 @@ void runModelFinder(Params &params, IQTree &iqtree, ModelCheckpoint &model_info,
         iqtree.aln->model_name = res_models;
     } else {
         // single model selection
+#ifdef _IQTREE_MPI
+        if (MPIHelper::getInstance().getNumProcesses() > 1)
+            evaluateModelsMPI(params, iqtree, model_info, models_block, params.num_threads);
+#endif
         CandidateModel best_model;
         if (params.openmp_by_model)
             best_model = CandidateModelSet().evaluateAll(params, &iqtree,
@@ -1614,7 +1741,7 @@ string CandidateModel::evaluate(Params &params,
 
     if (restoreCheckpoint(&in_model_info)) {
         delete iqtree;
-        return "";
+        return tree;
     }
 
 #ifdef _OPENMP
@@ -1977,6 +2104,114 @@ void mergePairs(vector<SubsetPair> &dest, vector<SubsetPair> &src) {
  * @param[in,out] model_info (IN/OUT) all model information
  * @return total number of parameters
  */
+/**
+ initialize the merged subset of two partition sets
+ @param in_tree super tree
+ @param gene_sets current partition sets
+ @param subset_pair IDs of the two partition sets
+ @param[out] cur_pair the merged pair
+ */
+void initMergedPair(PhyloSuperTree *in_tree, vector<set<int> > &gene_sets, SubsetPair &subset_pair, ModelPair &cur_pair) {
+    cur_pair.part1 = subset_pair.first;
+    cur_pair.part2 = subset_pair.second;
+    ASSERT(cur_pair.part1 < cur_pair.part2);
+    cur_pair.merged_set.insert(gene_sets[cur_pair.part1].begin(), gene_sets[cur_pair.part1].end());
+    cur_pair.merged_set.insert(gene_sets[cur_pair.part2].begin(), gene_sets[cur_pair.part2].end());
+    cur_pair.set_name = getSubsetName(in_tree, cur_pair.merged_set);
+}
+
+/**
+ test models for the merged subset of a partition pair
+ @param model_info model information of all subsets
+ @param[out] part_model_info model information of the merged subset
+ @param cur_pair the merged pair
+ @return best model of the merged subset
+ */
+CandidateModel testMergedPair(Params &params, PhyloSuperTree *in_tree, ModelCheckpoint &model_info,
+    ModelCheckpoint &part_model_info, ModelsBlock *models_block, int num_threads,
+    vector<set<int> > &gene_sets, DoubleVector &lenvec, ModelPair &cur_pair)
+{
+    SuperAlignment *super_aln = ((SuperAlignment*)in_tree->aln);
+    Alignment *aln = super_aln->concatenateAlignments(cur_pair.merged_set);
+    PhyloTree *tree = in_tree->extractSubtree(cur_pair.merged_set);
+    tree->scaleLength(sqrt(lenvec[cur_pair.part1]*lenvec[cur_pair.part2])/tree->treeLength());
+    tree->setAlignment(aln);
+    extractModelInfo(cur_pair.set_name, model_info, part_model_info);
+    transferModelParameters(in_tree, model_info, part_model_info, gene_sets[cur_pair.part1], gene_sets[cur_pair.part2]);
+    tree->num_precision = in_tree->num_precision;
+    tree->setParams(&params);
+    tree->sse = params.SSE;
+    tree->optimize_by_newton = params.optimize_by_newton;
+    tree->setNumThreads(num_threads);
+    {
+        tree->setCheckpoint(&part_model_info);
+        // trick to restore checkpoint
+        tree->restoreCheckpoint();
+        tree->saveCheckpoint();
+    }
+    CandidateModel best_model;
+    best_model = CandidateModelSet().test(params, tree, part_model_info, models_block,
+        num_threads, params.partition_type, cur_pair.set_name, "", true);
+    best_model.restoreCheckpoint(&part_model_info);
+    delete tree;
+    delete aln;
+    return best_model;
+}
+
+#ifdef _IQTREE_MPI
+/**
+ select the best model for each partition over MPI processes
+ @param partitionID list of (partition ID, estimated cost)
+ */
+void testPartitionsMPI(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint &model_info,
+    ModelsBlock *models_block, int num_threads, int brlen_type, vector<pair<int,double> > &partitionID,
+    bool merge_phase)
+{
+    distributeModelTasks(partitionID, model_info, [&](int part, ModelCheckpoint &task_info) {
+        PhyloTree *this_tree = in_tree->at(part);
+        ModelCheckpoint part_model_info;
+        extractModelInfo(this_tree->aln->name, model_info, part_model_info);
+        string part_model_name;
+        if (params.model_name.empty())
+            part_model_name = this_tree->aln->model_name;
+        CandidateModelSet().test(params, this_tree, part_model_info, models_block,
+            num_threads, brlen_type, this_tree->aln->name, part_model_name, merge_phase);
+        replaceModelInfo(this_tree->aln->name, task_info, part_model_info);
+    });
+}
+
+/**
+ test the merged subsets of partition pairs over MPI processes
+ @param closest_pairs partition pairs, the distance holds the negative estimated cost
+ @return number of merged subsets computed
+ */
+int testMergedPairsMPI(Params &params, PhyloSuperTree *in_tree, ModelCheckpoint &model_info,
+    ModelsBlock *models_block, vector<set<int> > &gene_sets, DoubleVector &lenvec,
+    vector<SubsetPair> &closest_pairs)
+{
+    vector<pair<int,double> > tasks;
+    for (int pair = 0; pair < closest_pairs.size(); pair++) {
+        ModelPair cur_pair;
+        initMergedPair(in_tree, gene_sets, closest_pairs[pair], cur_pair);
+        // skip pairs previously examined
+        string best_model;
+        model_info.startStruct(cur_pair.set_name);
+        bool done_before = model_info.getBestModel(best_model);
+        model_info.endStruct();
+        if (!done_before)
+            tasks.push_back({pair, -closest_pairs[pair].distance});
+    }
+    distributeModelTasks(tasks, model_info, [&](int pair, ModelCheckpoint &task_info) {
+        ModelPair cur_pair;
+        initMergedPair(in_tree, gene_sets, closest_pairs[pair], cur_pair);
+        ModelCheckpoint part_model_info;
+        testMergedPair(params, in_tree, model_info, part_model_info, models_block, 1, gene_sets, lenvec, cur_pair);
+        replaceModelInfo(cur_pair.set_name, task_info, part_model_info);
+    });
+    return tasks.size();
+}
+#endif
+
 void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint &model_info,
     ModelsBlock *models_block, int num_threads)
 {
@@ -2085,7 +2320,13 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
         brlen_type = BRLEN_OPTIMIZE;
     }
     bool test_merge = (params.partition_merge != MERGE_NONE) && params.partition_type != TOPO_UNLINKED && (in_tree->size() > 1);
-    
+#ifdef _IQTREE_MPI
+    // ModelOMatic may change the alignments, which has to be done identically on all processes
+    bool mpi_partitions = MPIHelper::getInstance().getNumProcesses() > 1 && !params.modelomatic;
+    if (mpi_partitions)
+        testPartitionsMPI(params, in_tree, model_info, models_block, num_threads, brlen_type, partitionID, test_merge);
+#endif
+
 #ifdef _OPENMP
     parallel_over_partitions = !params.model_test_and_tree && (in_tree->size() >= num_threads);
 #pragma omp parallel for private(i) schedule(dynamic) reduction(+: lhsum, dfsum) if(parallel_over_partitions)
@@ -2224,6 +2465,11 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
         }
         size_t num_pairs = closest_pairs.size();
         size_t compute_pairs = 0;
+
+#ifdef _IQTREE_MPI
+        if (MPIHelper::getInstance().getNumProcesses() > 1)
+            compute_pairs += testMergedPairsMPI(params, in_tree, model_info, models_block, gene_sets, lenvec, closest_pairs);
+#endif
         // progress_display progress(num_pairs, "Calculating subsets");
         // progress.setProgressDisplay(true);
 
@@ -2233,17 +2479,7 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
         for (size_t pair = 0; pair < num_pairs; pair++) {
             // information of current partitions pair
             ModelPair cur_pair;
-            cur_pair.part1 = closest_pairs[pair].first;
-            cur_pair.part2 = closest_pairs[pair].second;
-            ASSERT(cur_pair.part1 < cur_pair.part2);
-            cur_pair.merged_set.insert(gene_sets[cur_pair.part1].begin(), gene_sets[cur_pair.part1].end());
-            cur_pair.merged_set.insert(gene_sets[cur_pair.part2].begin(), gene_sets[cur_pair.part2].end());
-            cur_pair.set_name = getSubsetName(in_tree, cur_pair.merged_set);
-            double weight1 = getSubsetAlnLength(in_tree, gene_sets[cur_pair.part1]);
-            double weight2 = getSubsetAlnLength(in_tree, gene_sets[cur_pair.part2]);
-            double sum = 1.0 / (weight1 + weight2);
-            weight1 *= sum;
-            weight2 *= sum;
+            initMergedPair(in_tree, gene_sets, closest_pairs[pair], cur_pair);
             CandidateModel best_model;
             bool done_before = false;
 #ifdef _OPENMP
@@ -2259,32 +2495,9 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
                 model_info.endStruct();
             }
             ModelCheckpoint part_model_info;
-            double cur_tree_len = 0.0;
             if (!done_before) {
-                Alignment *aln = super_aln->concatenateAlignments(cur_pair.merged_set);
-                PhyloTree *tree = in_tree->extractSubtree(cur_pair.merged_set);
-                //tree->scaleLength((weight1*lenvec[cur_pair.part1] + weight2*lenvec[cur_pair.part2])/tree->treeLength());
-                tree->scaleLength(sqrt(lenvec[cur_pair.part1]*lenvec[cur_pair.part2])/tree->treeLength());
-                cur_tree_len = tree->treeLength();
-                tree->setAlignment(aln);
-                extractModelInfo(cur_pair.set_name, model_info, part_model_info);
-                transferModelParameters(in_tree, model_info, part_model_info, gene_sets[cur_pair.part1], gene_sets[cur_pair.part2]);
-                tree->num_precision = in_tree->num_precision;
-                tree->setParams(&params);
-                tree->sse = params.SSE;
-                tree->optimize_by_newton = params.optimize_by_newton;
-                tree->setNumThreads(params.model_test_and_tree ? num_threads : 1);
-                {
-                    tree->setCheckpoint(&part_model_info);
-                    // trick to restore checkpoint
-                    tree->restoreCheckpoint();
-                    tree->saveCheckpoint();
-                }
-                best_model = CandidateModelSet().test(params, tree, part_model_info, models_block,
-                    params.model_test_and_tree ? num_threads : 1, params.partition_type, cur_pair.set_name, "", true);
-                best_model.restoreCheckpoint(&part_model_info);
-                delete tree;
-                delete aln;
+                best_model = testMergedPair(params, in_tree, model_info, part_model_info, models_block,
+                    params.model_test_and_tree ? num_threads : 1, gene_sets, lenvec, cur_pair);
             }
             cur_pair.logl = best_model.logl;
             cur_pair.df = best_model.df;
@@ -2434,6 +2647,11 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
             std::sort(partitionID.begin(), partitionID.end(), comparePartition);
         }
 
+#ifdef _IQTREE_MPI
+        if (mpi_partitions)
+            testPartitionsMPI(params, in_tree, model_info, models_block, num_threads, brlen_type, partitionID, false);
+#endif
+
         cout << endl;
         cout << "No. Model        Score       Charset" << endl;
         int partition_id = 0;
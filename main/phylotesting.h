@@ -123,6 +123,8 @@ public:
         if (ckp->getString(getName(), val)) {
             stringstream str(val);
             str >> logl >> df >> tree_len;
+            tree.clear();
+            str >> tree;
             return true;
         }
         return false;
@@ -1067,6 +1067,133 @@ void performAUTest(Params &params, PhyloTree *tree, double *pattern_lhs, vector<
 }
 
 
+/**
+    read a tree and optimize its branch lengths, or the model with -zoptmodel
+    @param in stream at the tree
+    @param rooted rootedness the tree is read with
+*/
+void optimizeTreeToEvaluate(Params &params, IQTree *tree, istream &in, bool rooted) {
+    tree->freeNode();
+    tree->rooted = rooted;
+    tree->readTree(in, tree->rooted);
+    if (!tree->findNodeName(tree->aln->getSeqName(0))) {
+        outError("Taxon " + tree->aln->getSeqName(0) + " not found in tree");
+    }
+    
+    if (tree->rooted && tree->getModelFactory()->isReversible()) {
+        if (tree->leafNum != tree->aln->getNSeq()+1)
+            outError("Tree does not have same number of taxa as alignment");
+        tree->convertToUnrooted();
+//            cout << "convertToUnrooted" << endl;
+    } else if (!tree->rooted && !tree->getModelFactory()->isReversible()) {
+        if (tree->leafNum != tree->aln->getNSeq())
+            outError("Tree does not have same number of taxa as alignment");
+        tree->convertToRooted();
+//            cout << "convertToRooted" << endl;
+    }
+    tree->setAlignment(tree->aln);
+    tree->setRootNode(params.root);
+    if (tree->isSuperTree())
+        ((PhyloSuperTree*) tree)->mapTrees();
+    
+    tree->initializeAllPartialLh();
+    tree->fixNegativeBranch(false);
+    if (params.fixed_branch_length) {
+        tree->setCurScore(tree->computeLikelihood());
+    } else if (params.topotest_optimize_model) {
+        tree->getModelFactory()->optimizeParameters(BRLEN_OPTIMIZE, false, params.modelEps);
+        tree->setCurScore(tree->computeLikelihood());
+    } else {
+        tree->setCurScore(tree->optimizeAllBranches(100, 0.001));
+    }
+}
+
+/** alignments with fewer patterns per thread than this evaluate whole trees in parallel */
+const size_t MIN_PATTERNS_PER_THREAD = 1000;
+
+/**
+    decide between tree-level and pattern-level parallelism: with few patterns per thread,
+    the likelihood kernels do not keep the threads busy and whole trees are evaluated
+    concurrently instead, as far as the partial likelihoods of all threads fit in RAM
+    @return number of trees evaluated concurrently, 1 for pattern-level parallelism
+*/
+int decideTreeLevelThreads(Params &params, IQTree *tree, size_t ntrees) {
+#ifdef _OPENMP
+    int num_threads = tree->num_threads;
+    if (num_threads <= 1 || ntrees < 2)
+        return 1;
+    // the model is changed by -zoptmodel, other tree types keep extra state per tree
+    if (params.topotest_optimize_model || params.pll || tree->isSuperTree() || tree->isTreeMix() || tree->isMixlen())
+        return 1;
+    if (tree->getAlnNPattern() >= MIN_PATTERNS_PER_THREAD * num_threads)
+        return 1;
+    int tree_threads = min((size_t)num_threads, ntrees);
+    uint64_t mem_per_tree = tree->getMemoryRequired();
+    while (tree_threads > 1 && mem_per_tree * tree_threads > getMemorySize()/2)
+        tree_threads--;
+    return tree_threads;
+#else
+    return 1;
+#endif
+}
+
+/**
+    optimize trees concurrently, each thread on its own IQTree sharing the alignment,
+    model and rate heterogeneity of tree, which are left unchanged
+    @param tree_strings trees in NEWICK
+    @param[out] printed_trees optimized trees
+    @param[out] tree_formats stream format flags and precision left by printing each tree
+    @param[out] logls tree log-likelihoods
+    @param[out] ptn_lhs pattern log-likelihoods, maxnptn per tree, or NULL
+*/
+void optimizeTreesInParallel(Params &params, IQTree *tree, vector<string> &tree_strings, int tree_threads,
+                             vector<string> &printed_trees, vector<pair<ios::fmtflags, streamsize> > &tree_formats, DoubleVector &logls,
+                             double *ptn_lhs, size_t maxnptn)
+{
+    size_t ntrees = tree_strings.size();
+    bool rooted = tree->rooted;
+    printed_trees.resize(ntrees);
+    tree_formats.resize(ntrees);
+    logls.resize(ntrees);
+#ifdef _OPENMP
+#pragma omp parallel num_threads(tree_threads)
+#endif
+    {
+        IQTree *thread_tree = new IQTree(tree->aln);
+        thread_tree->setParams(&params);
+        thread_tree->optimize_by_newton = params.optimize_by_newton;
+        // the kernel decides on safe scaling from leafNum, so match the main tree
+        thread_tree->leafNum = tree->leafNum;
+        thread_tree->setLikelihoodKernel(params.SSE);
+        thread_tree->setNumThreads(1);
+        thread_tree->setModelFactory(tree->getModelFactory());
+        thread_tree->setModel(tree->getModel());
+        thread_tree->setRate(tree->getRate());
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (size_t tid = 0; tid < ntrees; tid++) {
+            istringstream in(tree_strings[tid]);
+            optimizeTreeToEvaluate(params, thread_tree, in, rooted);
+            ostringstream out;
+            thread_tree->printTree(out);
+            printed_trees[tid] = out.str();
+            tree_formats[tid] = make_pair(out.flags(), out.precision());
+            logls[tid] = thread_tree->getCurScore();
+            if (ptn_lhs) {
+                double cur_score = thread_tree->getCurScore();
+                memset(ptn_lhs + tid*maxnptn, 0, maxnptn*sizeof(double));
+                thread_tree->computePatternLikelihood(ptn_lhs + tid*maxnptn, &cur_score);
+            }
+        }
+        // reset model & rate so that they are not deleted
+        thread_tree->setModel(NULL);
+        thread_tree->setModelFactory(NULL);
+        thread_tree->setRate(NULL);
+        delete thread_tree;
+    }
+}
+
 void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &info, IntVector &distinct_ids)
 {
     cout << endl;
@@ -1180,12 +1307,35 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
     info.resize(ntrees);
     string saved_tree;
     saved_tree = tree->getTreeString();
+    int tree_threads = decideTreeLevelThreads(params, tree, ntrees);
+    vector<string> printed_trees;
+    DoubleVector tree_logls;
+    double *tree_ptn_lhs = NULL; // pattern log-likelihoods of all trees evaluated in parallel
+    vector<pair<ios::fmtflags, streamsize> > tree_formats;
+    if (tree_threads > 1) {
+        cout << "Evaluating trees in parallel with " << tree_threads << " threads" << endl;
+        vector<string> tree_strings;
+        for (tree_index = 0; tree_index < distinct_ids.size(); tree_index++) {
+            string tree_str;
+            getline(in, tree_str, ';');
+            if (distinct_ids[tree_index] < 0)
+                tree_strings.push_back(tree_str + ";");
+        }
+        if (pattern_lhs)
+            tree_ptn_lhs = pattern_lhs;
+        else if (pattern_lh || params.print_site_lh)
+            tree_ptn_lhs = aligned_alloc<double>(ntrees*maxnptn);
+        optimizeTreesInParallel(params, tree, tree_strings, tree_threads, printed_trees, tree_formats,
+                                tree_logls, tree_ptn_lhs, maxnptn);
+    }
     //for (MTreeSet::iterator it = trees.begin(); it != trees.end(); it++, tree_index++) {
     for (tree_index = 0, tid = 0; tree_index < distinct_ids.size(); tree_index++) {
         
         cout << "Tree " << tree_index + 1;
         if (distinct_ids[tree_index] >= 0) {
             cout << " / identical to tree " << distinct_ids[tree_index]+1 << endl;
+            if (tree_threads > 1)
+                continue;
             // ignore tree
             char ch;
             do {
@@ -1193,47 +1343,29 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
             } while (!in.eof() && ch != ';');
             continue;
         }
-        tree->freeNode();
-        tree->readTree(in, tree->rooted);
-        if (!tree->findNodeName(tree->aln->getSeqName(0))) {
-            outError("Taxon " + tree->aln->getSeqName(0) + " not found in tree");
-        }
-        
-        if (tree->rooted && tree->getModelFactory()->isReversible()) {
-            if (tree->leafNum != tree->aln->getNSeq()+1)
-                outError("Tree does not have same number of taxa as alignment");
-            tree->convertToUnrooted();
-//            cout << "convertToUnrooted" << endl;
-        } else if (!tree->rooted && !tree->getModelFactory()->isReversible()) {
-            if (tree->leafNum != tree->aln->getNSeq())
-                outError("Tree does not have same number of taxa as alignment");
-            tree->convertToRooted();
-//            cout << "convertToRooted" << endl;
-        }
-        tree->setAlignment(tree->aln);
-        tree->setRootNode(params.root);
-        if (tree->isSuperTree())
-            ((PhyloSuperTree*) tree)->mapTrees();
-        
-        tree->initializeAllPartialLh();
-        tree->fixNegativeBranch(false);
-        if (params.fixed_branch_length) {
-            tree->setCurScore(tree->computeLikelihood());
-        } else if (params.topotest_optimize_model) {
-            tree->getModelFactory()->optimizeParameters(BRLEN_OPTIMIZE, false, params.modelEps);
-            tree->setCurScore(tree->computeLikelihood());
+        double logl;
+        if (tree_threads > 1) {
+            logl = tree_logls[tid];
+            treeout << "[ tree " << tree_index+1 << " lh=" << logl << " ]" << printed_trees[tid];
+            // as printTree() on treeout, which also sets the format of the next lh
+            treeout.flags(tree_formats[tid].first);
+            treeout.precision(tree_formats[tid].second);
         } else {
-            tree->setCurScore(tree->optimizeAllBranches(100, 0.001));
+            optimizeTreeToEvaluate(params, tree, in, tree->rooted);
+            logl = tree->getCurScore();
+            treeout << "[ tree " << tree_index+1 << " lh=" << logl << " ]";
+            tree->printTree(treeout);
         }
-        treeout << "[ tree " << tree_index+1 << " lh=" << tree->getCurScore() << " ]";
-        tree->printTree(treeout);
         treeout << endl;
         if (params.print_tree_lh)
-            scoreout << tree->getCurScore() << endl;
+            scoreout << logl << endl;
         
-        cout << " / LogL: " << tree->getCurScore() << endl;
+        cout << " / LogL: " << logl << endl;
         
-        if (pattern_lh) {
+        if (tree_ptn_lhs) {
+            if (pattern_lh)
+                memcpy(pattern_lh, tree_ptn_lhs + tid*maxnptn, maxnptn*sizeof(double));
+        } else if (pattern_lh) {
             double curScore = tree->getCurScore();
             memset(pattern_lh, 0, maxnptn*sizeof(double));
             tree->computePatternLikelihood(pattern_lh, &curScore);
@@ -1242,20 +1374,20 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
         }
         if (params.print_site_lh) {
             string tree_name = "Tree" + convertIntToString(tree_index+1);
-            printSiteLh(site_lh_file.c_str(), tree, pattern_lh, true, tree_name.c_str());
+            printSiteLh(site_lh_file.c_str(), tree, tree_ptn_lhs ? tree_ptn_lhs + tid*maxnptn : pattern_lh, true, tree_name.c_str());
         }
         if (params.print_partition_lh) {
             string tree_name = "Tree" + convertIntToString(tree_index+1);
             printPartitionLh(part_lh_file.c_str(), tree, pattern_lh, true, tree_name.c_str());
         }
-        info[tid].logl = tree->getCurScore();
+        info[tid].logl = logl;
         
         if (!params.topotest_replicates || ntrees <= 1) {
             tid++;
             continue;
         }
         // now compute RELL scores
-        orig_tree_lh[tid] = tree->getCurScore();
+        orig_tree_lh[tid] = logl;
         double *tree_lhs_offset = tree_lhs + (tid*params.topotest_replicates);
         for (size_t boot = 0; boot < params.topotest_replicates; boot++) {
             double lh = 0.0;
@@ -1485,6 +1617,8 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
         delete [] tree_probs;
         
     }
+    if (tree_ptn_lhs != pattern_lhs)
+        aligned_free(tree_ptn_lhs);
     delete [] max_lh;
     delete [] orig_tree_lh;
     aligned_free(pattern_lh);
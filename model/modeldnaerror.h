@@ -70,6 +70,9 @@ public:
     */
     virtual int getNDim();
 
+    /** the error probability enters the tip likelihoods, use numerical gradient */
+    virtual bool hasAnalyticGradient() { return false; }
+
     /**
      * setup the bounds for joint optimization with BFGS
      */
@@ -171,6 +171,7 @@ ModelFactory::ModelFactory(Params &params, string &model_name, PhyloTree *tree,
         if (tree->aln->seq_type != SEQ_POMO && !params.model_joint)
             outWarning("Default model "+model_str + " may be under-fitting. Use option '-m TEST' to determine the best-fit model.");
     }
+    model_spec = model_str;
     // handle continuous gamma model => remove 'C' from model_name to make sure it doesn't cause error when parsing model
     if (model_str.find("+GC") != std::string::npos) {
         std::string tmp_model_str(1, model_str[0]);
@@ -1579,6 +1580,16 @@ double ModelFactory::targetFunk(double x[]) {
     return site_rate->targetFunk(x + model->getNDim());
 }
 
+int ModelFactory::prepareGradientWorkers() {
+    return site_rate->phylo_tree->prepareGradientClones() + 1;
+}
+
+Optimization *ModelFactory::getGradientWorker(int worker) {
+    if (worker == 0)
+        return this;
+    return site_rate->phylo_tree->getGradientClone(worker-1)->getModelFactory();
+}
+
 void ModelFactory::setVariables(double *variables) {
     model->setVariables(variables);
     site_rate->setVariables(variables + model->getNDim());
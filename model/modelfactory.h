@@ -216,6 +216,12 @@ public:
 	*/
 	RateHeterogeneity *site_rate;
 
+	/**
+		model name this object was created from, empty if not created from a name.
+		Used to create an identical model, as the name of mixture models does not parse back.
+	*/
+	string model_spec;
+
 	/* TRUE if a fused mixture and rate model, e.g. LG4M and LG4X */
 	bool fused_mix_rate;
 
@@ -272,6 +278,18 @@ public:
 	*/
 	virtual double targetFunk(double x[]);
 
+	/**
+		prepare the copies of the tree to evaluate targetFunk() concurrently (--thread-grad)
+		@return number of workers
+	*/
+	virtual int prepareGradientWorkers();
+
+	/**
+		@param worker worker ID
+		@return this object for worker 0, otherwise the model factory of the tree copy
+	*/
+	virtual Optimization *getGradientWorker(int worker);
+
 	double initGTRGammaIParameters(RateHeterogeneity *rate, ModelSubst *model, double initAlpha,
 								 double initPInvar, double *initRates, double *initStateFreqs);
 
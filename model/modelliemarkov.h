@@ -66,6 +66,9 @@ public:
      */
     virtual bool isLieMarkov() { return true; }
 
+    /** the rate matrix is computed from the Lie-Markov basis, use numerical gradient */
+    virtual bool hasAnalyticGradient() { return false; }
+
     /**
          initialize random state frequencies when running AliSim without inference mode
     */
@@ -1117,6 +1117,117 @@ double ModelMarkov::targetFunk(double x[]) {
 
 }
 
+bool ModelMarkov::hasAnalyticGradient() {
+    return is_reversible && half_matrix;
+}
+
+void ModelMarkov::getNormalizedQMatrix(double *q_mat, double *freq) {
+    int i, j, k;
+    double sum = 0.0;
+    for (i = 0; i < num_states; i++)
+        sum += state_freq[i];
+    for (i = 0; i < num_states; i++)
+        freq[i] = state_freq[i] / sum;
+
+    double **rate_matrix = new double*[num_states];
+    for (i = 0; i < num_states; i++)
+        rate_matrix[i] = q_mat + i*num_states;
+    for (i = 0, k = 0; i < num_states; i++) {
+        rate_matrix[i][i] = 0.0;
+        for (j = i+1; j < num_states; j++, k++)
+            rate_matrix[i][j] = rate_matrix[j][i] = rates[k];
+    }
+    computeRateMatrix(rate_matrix, freq, num_states);
+    delete [] rate_matrix;
+}
+
+double ModelMarkov::derivativeFunk(double x[], double dfx[]) {
+    if (!hasAnalyticGradient() || !phylo_tree->isLikelihoodGradientSupported())
+        return Optimization::derivativeFunk(x, dfx);
+    // invariant sites depend on the state frequencies, not covered by the analytic gradient
+    if (freq_type == FREQ_ESTIMATE && phylo_tree->getRate()->getPInvar() > 0.0)
+        return Optimization::derivativeFunk(x, dfx);
+
+    double fx = targetFunk(x);
+    bool zero_freq = false;
+    for (int i = 0; i < num_states; i++)
+        zero_freq |= (state_freq[i] <= ZERO_FREQ);
+    LikelihoodGradient grad;
+    if (fx >= 1.0e+30 || zero_freq || !phylo_tree->computeLikelihoodGradient(grad))
+        return Optimization::derivativeFunk(x, dfx);
+
+    // dlnL/dx = sum_ij grad_ij * (U^-1 dQ/dx U)_ij + sum_i freq_grad_i * dpi_i/dx,
+    // where the rate matrix is differentiated numerically without touching the tree
+    int ndim = getNDim();
+    int nsqr = num_states*num_states;
+    DoubleVector q_plus(nsqr), q_minus(nsqr), dq(nsqr), dq_u(nsqr), f_plus(num_states), f_minus(num_states);
+    for (int dim = 1; dim <= ndim; dim++) {
+        double temp = x[dim];
+        double h = 1e-6 * max(fabs(temp), 1.0);
+        x[dim] = temp + h;
+        getVariables(x);
+        getNormalizedQMatrix(q_plus.data(), f_plus.data());
+        x[dim] = temp - h;
+        getVariables(x);
+        getNormalizedQMatrix(q_minus.data(), f_minus.data());
+        x[dim] = temp;
+        for (int k = 0; k < nsqr; k++)
+            dq[k] = (q_plus[k] - q_minus[k]) / (2*h);
+        // dq_u = dQ U
+        for (int k = 0; k < num_states; k++)
+            for (int j = 0; j < num_states; j++) {
+                double sum = 0.0;
+                for (int l = 0; l < num_states; l++)
+                    sum += dq[k*num_states+l] * eigenvectors[l*num_states+j];
+                dq_u[k*num_states+j] = sum;
+            }
+        double dlnl = 0.0;
+        for (int i = 0; i < num_states; i++) {
+            dlnl += grad.freq_grad[i] * (f_plus[i] - f_minus[i]) / (2*h);
+            for (int j = 0; j < num_states; j++) {
+                double m = 0.0;
+                for (int k = 0; k < num_states; k++)
+                    m += inv_eigenvectors[i*num_states+k] * dq_u[k*num_states+j];
+                dlnl += grad.eigen_grad[i*num_states+j] * m;
+            }
+        }
+        dfx[dim] = -dlnl;
+    }
+    // restore the parameters, the eigen decomposition is still valid
+    getVariables(x);
+    if (verbose_mode >= VB_DEBUG) {
+        DoubleVector num_dfx(ndim+1);
+        for (int dim = 1; dim <= ndim; dim++) {
+            double temp = x[dim];
+            double h = 1e-4 * max(fabs(temp), 1e-2);
+            x[dim] = temp + h;
+            num_dfx[dim] = targetFunk(x);
+            x[dim] = temp - h;
+            num_dfx[dim] = (num_dfx[dim] - targetFunk(x)) / (2*h);
+            x[dim] = temp;
+        }
+        targetFunk(x);
+        cout << "Analytic vs. numerical gradient:";
+        for (int dim = 1; dim <= ndim; dim++)
+            cout << " " << dfx[dim] << "/" << num_dfx[dim];
+        cout << endl;
+    }
+    return fx;
+}
+
+int ModelMarkov::prepareGradientWorkers() {
+    // e.g. a mixture component optimized on its own is not copied
+    if (!phylo_tree || phylo_tree->getModel() != this)
+        return 1;
+    return phylo_tree->prepareGradientClones() + 1;
+}
+
+Optimization *ModelMarkov::getGradientWorker(int worker) {
+    if (worker == 0)
+        return this;
+    return phylo_tree->getGradientClone(worker-1)->getModel();
+}
+
 bool ModelMarkov::isUnstableParameters() {
 	int nrates = getNumRateEntries();
 	int i;
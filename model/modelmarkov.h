@@ -303,6 +303,41 @@ public:
 	*/
 	virtual double targetFunk(double x[]);
 
+	/**
+		the derivative of targetFunk, computed analytically from the partial likelihoods
+		if supported, otherwise by finite differences
+		@param x the input vector x
+		@param dfx the derivative at x
+		@return the function value at x
+	*/
+	virtual double derivativeFunk(double x[], double dfx[]);
+
+	/**
+		@return TRUE if the rate matrix depends only on rates and state_freq,
+		such that derivativeFunk can use the analytic gradient
+	*/
+	virtual bool hasAnalyticGradient();
+
+	/**
+		compute the normalized rate matrix and frequencies from rates and state_freq
+		exactly as done by the eigen decomposition
+		@param[out] q_mat rate matrix (num_states*num_states)
+		@param[out] freq state frequencies normalized to sum 1
+	*/
+	void getNormalizedQMatrix(double *q_mat, double *freq);
+
+	/**
+		prepare the copies of the tree to evaluate targetFunk() concurrently (--thread-grad)
+		@return number of workers, 1 if this is not the model of the tree
+	*/
+	virtual int prepareGradientWorkers();
+
+	/**
+		@param worker worker ID
+		@return this object for worker 0, otherwise the model of the tree copy
+	*/
+	virtual Optimization *getGradientWorker(int worker);
+
 	/**
 	 * setup the bounds for joint optimization with BFGS
 	 */
@@ -1886,6 +1886,16 @@ double ModelMixture::targetFunk(double x[]) {
     
 }
 
+Optimization *ModelMixture::getGradientWorker(int worker) {
+    if (worker == 0)
+        return this;
+    ModelMixture *model = dynamic_cast<ModelMixture*>(phylo_tree->getGradientClone(worker-1)->getModel());
+    ASSERT(model);
+    // optimizing the linked substitution model or all parameters
+    model->optimizing_gtr = optimizing_gtr;
+    return model;
+}
+
 double ModelMixture::optimizeWeights() {
     // first compute _pattern_lh_cat
     phylo_tree->computePatternLhCat(WSL_MIXTURE);
@@ -194,6 +194,13 @@ public:
 	*/
 	virtual double targetFunk(double x[]);
 
+	/**
+		@param worker worker ID
+		@return this object for worker 0, otherwise the model of the tree copy
+		in the same optimization state
+	*/
+	virtual Optimization *getGradientWorker(int worker);
+
     /** 
         optimize mixture weights using EM algorithm 
         @return log-likelihood of optimized weights
@@ -304,6 +304,50 @@ double RateFree::targetFunk(double x[]) {
 	return -phylo_tree->computeLikelihood();
 }
 
+double RateFree::derivativeFunk(double x[], double dfx[]) {
+    if (!phylo_tree->isLikelihoodGradientSupported())
+        return Optimization::derivativeFunk(x, dfx);
+    double fx = targetFunk(x);
+    LikelihoodGradient grad;
+    if (fx >= 1.0e+30 || !phylo_tree->computeLikelihoodGradient(grad))
+        return Optimization::derivativeFunk(x, dfx);
+
+    // chain rule over the category rates, proportions and p_invar, which are
+    // differentiated numerically as they are cheap functions of the variables
+    int ndim = getNDim();
+    DoubleVector rate_plus(ncategory), prop_plus(ncategory);
+    for (int dim = 1; dim <= ndim; dim++) {
+        double temp = x[dim];
+        double h = 1e-6 * max(fabs(temp), 1.0);
+        x[dim] = temp + h;
+        getVariables(x);
+        for (int c = 0; c < ncategory; c++) {
+            rate_plus[c] = getRate(c);
+            prop_plus[c] = getProp(c);
+        }
+        double pinv_plus = getPInvar();
+        x[dim] = temp - h;
+        getVariables(x);
+        x[dim] = temp;
+        double dlnl = grad.invar_grad * (pinv_plus - getPInvar());
+        for (int c = 0; c < ncategory; c++)
+            dlnl += grad.rate_grad[c] * (rate_plus[c] - getRate(c)) + grad.prop_grad[c] * (prop_plus[c] - getProp(c));
+        dfx[dim] = -dlnl / (2*h);
+    }
+    getVariables(x);
+    return fx;
+}
+
+Optimization *RateFree::getGradientWorker(int worker) {
+    if (worker == 0)
+        return this;
+    RateFree *rate = dynamic_cast<RateFree*>(phylo_tree->getGradientClone(worker-1)->getRate());
+    ASSERT(rate);
+    // rates and/or proportions
+    rate->optimizing_params = optimizing_params;
+    return rate;
+}
+
 /**
 	optimize parameters. Default is to optimize gamma shape
 	@return the best likelihood
@@ -81,6 +81,22 @@ public:
 	*/
 	virtual double targetFunk(double x[]);
 
+	/**
+		the derivative of targetFunk, computed analytically from the partial likelihoods
+		if supported, otherwise by finite differences
+		@param x the input vector x
+		@param dfx the derivative at x
+		@return the function value at x
+	*/
+	virtual double derivativeFunk(double x[], double dfx[]);
+
+	/**
+		@param worker worker ID
+		@return this object for worker 0, otherwise the rate model of the tree copy
+		in the same optimization state
+	*/
+	virtual Optimization *getGradientWorker(int worker);
+
 	/**
 	 * setup the bounds for joint optimization with BFGS
 	 */
@@ -80,3 +80,15 @@ void RateHeterogeneity::writeSiteRates(const char *file_name) {
 double RateHeterogeneity::targetFunk(double x[]) {
 	return -phylo_tree->computeLikelihood();
 }
+
+int RateHeterogeneity::prepareGradientWorkers() {
+	if (!phylo_tree || phylo_tree->getRate() != this)
+		return 1;
+	return phylo_tree->prepareGradientClones() + 1;
+}
+
+Optimization *RateHeterogeneity::getGradientWorker(int worker) {
+	if (worker == 0)
+		return this;
+	return phylo_tree->getGradientClone(worker-1)->getRate();
+}
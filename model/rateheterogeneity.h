@@ -251,6 +251,18 @@ public:
 	*/
 	virtual double targetFunk(double x[]);
 
+	/**
+		prepare the copies of the tree to evaluate targetFunk() concurrently (--thread-grad)
+		@return number of workers, 1 if this is not the rate model of the tree
+	*/
+	virtual int prepareGradientWorkers();
+
+	/**
+		@param worker worker ID
+		@return this object for worker 0, otherwise the rate model of the tree copy
+	*/
+	virtual Optimization *getGradientWorker(int worker);
+
 	/**
 	 * setup the bounds for joint optimization with BFGS
 	 */
@@ -0,0 +1,76 @@
+/*
+ * boottreeset.cpp
+ * compact storage of UFBoot trees, where each distinct tree is stored once
+ */
+
+#include "boottreeset.h"
+
+void BootTreeSet::resize(size_t num_samples) {
+    for (size_t sample = num_samples; sample < sample_tree.size(); sample++)
+        setTreeID(sample, -1);
+    sample_tree.resize(num_samples, -1);
+}
+
+void BootTreeSet::clear() {
+    trees.clear();
+    ref_counts.clear();
+    free_ids.clear();
+    index.clear();
+    sample_tree.clear();
+}
+
+int BootTreeSet::insertTree(const string &tree_str) {
+    size_t key = hash<string>()(tree_str);
+    auto range = index.equal_range(key);
+    for (auto it = range.first; it != range.second; it++)
+        if (trees[it->second] == tree_str)
+            return it->second;
+    int id;
+    if (!free_ids.empty()) {
+        id = free_ids.back();
+        free_ids.pop_back();
+        trees[id] = tree_str;
+        ref_counts[id] = 0;
+    } else {
+        id = trees.size();
+        trees.push_back(tree_str);
+        ref_counts.push_back(0);
+    }
+    index.insert({key, id});
+    return id;
+}
+
+void BootTreeSet::setTreeID(size_t sample, int id) {
+    int old_id = sample_tree[sample];
+    if (old_id == id)
+        return;
+    if (id >= 0)
+        ref_counts[id]++;
+    sample_tree[sample] = id;
+    if (old_id < 0 || --ref_counts[old_id] > 0)
+        return;
+    // release the tree not referred to anymore
+    auto range = index.equal_range(hash<string>()(trees[old_id]));
+    for (auto it = range.first; it != range.second; it++)
+        if (it->second == old_id) {
+            index.erase(it);
+            break;
+        }
+    string().swap(trees[old_id]);
+    free_ids.push_back(old_id);
+}
+
+void BootTreeSet::getDistinctTrees(StrVector &distinct_trees, IntVector &sample_ids, size_t start, int end) const {
+    size_t stop = (end < 0) ? sample_tree.size() : end;
+    IntVector new_ids(trees.size(), -1);
+    distinct_trees.clear();
+    sample_ids.clear();
+    for (size_t sample = start; sample < stop; sample++) {
+        int id = sample_tree[sample];
+        if (id >= 0 && new_ids[id] < 0) {
+            new_ids[id] = distinct_trees.size();
+            distinct_trees.push_back(trees[id]);
+        }
+        sample_ids.push_back(id < 0 ? -1 : new_ids[id]);
+    }
+}
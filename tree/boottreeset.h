@@ -0,0 +1,117 @@
+/*
+ * boottreeset.h
+ * compact storage of UFBoot trees, where each distinct tree is stored once
+ */
+
+#ifndef BOOTTREESET_H
+#define BOOTTREESET_H
+
+#include "utils/tools.h"
+#include <unordered_map>
+
+/**
+    UFBoot trees of all bootstrap samples.
+    Each distinct tree string is stored only once and every bootstrap sample keeps
+    the integer ID of its tree. Trees are printed with taxon IDs and sorted taxa,
+    thus identical topologies (with the same root) have identical strings.
+    Trees no longer referred to by any sample are released and their IDs reused.
+*/
+class BootTreeSet {
+public:
+
+    /** @return number of bootstrap samples */
+    size_t size() const {
+        return sample_tree.size();
+    }
+
+    /** @return true if there is no bootstrap sample */
+    bool empty() const {
+        return sample_tree.empty();
+    }
+
+    /**
+        set the number of bootstrap samples, new samples do not have a tree
+        @param num_samples number of bootstrap samples
+    */
+    void resize(size_t num_samples);
+
+    /** remove all samples and trees */
+    void clear();
+
+    /**
+        @param sample bootstrap sample ID
+        @return tree string of the sample, empty string if the sample has no tree
+    */
+    const string &operator[](size_t sample) const {
+        return (sample_tree[sample] < 0) ? empty_tree : trees[sample_tree[sample]];
+    }
+
+    /**
+        @param sample bootstrap sample ID
+        @return ID of the tree of the sample, -1 if the sample has no tree
+    */
+    int getTreeID(size_t sample) const {
+        return sample_tree[sample];
+    }
+
+    /** @return number of distinct trees */
+    size_t getNumTrees() const {
+        return index.size();
+    }
+
+    /**
+        add a tree string if not present yet. The returned ID should be assigned
+        to a sample by setTreeID(), otherwise the tree is never released.
+        @param tree_str tree string
+        @return ID of the tree
+    */
+    int insertTree(const string &tree_str);
+
+    /**
+        let a bootstrap sample refer to a tree
+        @param sample bootstrap sample ID
+        @param id tree ID returned by insertTree(), -1 to remove the tree of the sample
+    */
+    void setTreeID(size_t sample, int id);
+
+    /**
+        set the tree string of a bootstrap sample
+        @param sample bootstrap sample ID
+        @param tree_str tree string, empty string to remove the tree of the sample
+    */
+    void setTree(size_t sample, const string &tree_str) {
+        setTreeID(sample, tree_str.empty() ? -1 : insertTree(tree_str));
+    }
+
+    /**
+        get the distinct trees of a range of bootstrap samples in the order of first appearance
+        @param[out] distinct_trees distinct tree strings
+        @param[out] sample_ids index into distinct_trees for each sample in the range, -1 if no tree
+        @param start first sample
+        @param end past-the-last sample, -1 for all remaining samples
+    */
+    void getDistinctTrees(StrVector &distinct_trees, IntVector &sample_ids, size_t start = 0, int end = -1) const;
+
+protected:
+
+    /** distinct tree strings indexed by tree ID */
+    StrVector trees;
+
+    /** number of samples referring to each tree */
+    IntVector ref_counts;
+
+    /** IDs of released trees for reuse */
+    IntVector free_ids;
+
+    /** hash value of tree string -> tree ID */
+    unordered_multimap<size_t, int> index;
+
+    /** tree ID of each bootstrap sample */
+    IntVector sample_tree;
+
+    /** returned for samples without tree */
+    string empty_tree;
+
+};
+
+#endif
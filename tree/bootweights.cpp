@@ -0,0 +1,64 @@
+/*
+ * bootweights.cpp
+ * compact storage of UFBoot pattern weights as small integers
+ */
+
+#include "bootweights.h"
+
+void BootWeights::init(int num_bits, size_t num_samples, size_t num_patterns) {
+    ASSERT(num_bits == 8 || num_bits == 16);
+    clear();
+    bits = num_bits;
+    nptn = num_patterns;
+    if (bits == 8) {
+        escape = UINT8_MAX;
+        codes8.resize(num_samples * nptn, 0);
+    } else {
+        escape = UINT16_MAX;
+        codes16.resize(num_samples * nptn, 0);
+    }
+    overflow.resize(num_samples);
+}
+
+void BootWeights::clear() {
+    bits = 0;
+    nptn = 0;
+    escape = 0;
+    vector<uint8_t>().swap(codes8);
+    vector<uint16_t>().swap(codes16);
+    overflow.clear();
+}
+
+void BootWeights::setSample(size_t sample, IntVector &weights) {
+    ASSERT(weights.size() >= nptn);
+    overflow[sample].clear();
+    for (size_t ptn = 0; ptn < nptn; ptn++) {
+        int code = weights[ptn];
+        if (code >= escape) {
+            overflow[sample].push_back(make_pair((int)ptn, weights[ptn]));
+            code = escape;
+        }
+        if (bits == 8)
+            codes8[sample*nptn + ptn] = code;
+        else
+            codes16[sample*nptn + ptn] = code;
+    }
+}
+
+int BootWeights::getWeight(size_t sample, size_t ptn) const {
+    int code = (bits == 8) ? codes8[sample*nptn + ptn] : codes16[sample*nptn + ptn];
+    if (code < escape)
+        return code;
+    for (auto it = overflow[sample].begin(); it != overflow[sample].end(); it++)
+        if (it->first == (int)ptn)
+            return it->second;
+    ASSERT(0 && "overflowed weight not found");
+    return code;
+}
+
+size_t BootWeights::getNumOverflows() const {
+    size_t num = 0;
+    for (auto it = overflow.begin(); it != overflow.end(); it++)
+        num += it->size();
+    return num;
+}
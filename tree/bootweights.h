@@ -0,0 +1,105 @@
+/*
+ * bootweights.h
+ * compact storage of UFBoot pattern weights as small integers
+ */
+
+#ifndef BOOTWEIGHTS_H
+#define BOOTWEIGHTS_H
+
+#include "utils/tools.h"
+#include <stdint.h>
+
+/**
+    Pattern weights of the UFBoot samples stored as 8-bit or 16-bit unsigned integers
+    instead of BootValType, one row per sample. Resampled pattern counts are small,
+    only a few very frequent patterns may exceed the largest code. Such weights are
+    stored as the escape code and kept exactly in an overflow list of the sample.
+*/
+class BootWeights {
+public:
+
+    BootWeights() {
+        bits = 0;
+        nptn = 0;
+        escape = 0;
+    }
+
+    /**
+        allocate the weights of all samples
+        @param num_bits 8 or 16
+        @param num_samples number of bootstrap samples
+        @param num_patterns number of patterns
+    */
+    void init(int num_bits, size_t num_samples, size_t num_patterns);
+
+    /** @return true if compact weights are not used */
+    bool empty() const {
+        return bits == 0;
+    }
+
+    /** release all memory */
+    void clear();
+
+    /**
+        set the weights of a bootstrap sample
+        @param sample bootstrap sample ID
+        @param weights pattern weights
+    */
+    void setSample(size_t sample, IntVector &weights);
+
+    /**
+        @param sample bootstrap sample ID
+        @param ptn pattern ID
+        @return weight of the pattern in the sample
+    */
+    int getWeight(size_t sample, size_t ptn) const;
+
+    /**
+        decode the weights of a sample for a range of patterns
+        @param sample bootstrap sample ID
+        @param start first pattern
+        @param end past-the-last pattern
+        @param[out] buffer weights of patterns start..end-1
+    */
+    template <class Numeric>
+    void decode(size_t sample, int start, int end, Numeric *buffer) const {
+        if (bits == 8) {
+            const uint8_t *row = &codes8[sample*nptn];
+            for (int ptn = start; ptn < end; ptn++)
+                buffer[ptn-start] = row[ptn];
+        } else {
+            const uint16_t *row = &codes16[sample*nptn];
+            for (int ptn = start; ptn < end; ptn++)
+                buffer[ptn-start] = row[ptn];
+        }
+        for (auto it = overflow[sample].begin(); it != overflow[sample].end() && it->first < end; it++)
+            if (it->first >= start)
+                buffer[it->first-start] = it->second;
+    }
+
+    /** @return number of overflowed weights of all samples */
+    size_t getNumOverflows() const;
+
+protected:
+
+    /** 8 or 16, 0 if not used */
+    int bits;
+
+    /** number of patterns, length of each row */
+    size_t nptn;
+
+    /** largest code, which marks an overflowed weight */
+    int escape;
+
+    /** weights for 8-bit codes */
+    vector<uint8_t> codes8;
+
+    /** weights for 16-bit codes */
+    vector<uint16_t> codes16;
+
+    /** (pattern, weight) of overflowed weights of each sample, sorted by pattern */
+    vector<vector<pair<int,int> > > overflow;
+
+};
+
+#endif
@@ -97,7 +97,12 @@ void Alignment::computeQuartetSupports(IntVector &quartet, vector<int64_t> &supp
     // sanity check e.g. when having rooted tree
     for (auto q = quartet.begin(); q != quartet.end(); q++)
         ASSERT(*q < getNSeq());
-        
+
+    if (hasPackedStates()) {
+        packed_states.computeQuartetSupports(&quartet[0], *this, &support[0]);
+        return;
+    }
+
     for (auto pat = begin(); pat != end(); pat++) {
         if (!pat->isInformative()) continue;
         bool informative = true;
@@ -61,6 +61,7 @@ void IQTree::init() {
 //    write_intermediate_trees = 0;
 //    max_candidate_trees = 0;
     logl_cutoff = 0.0;
+    rell_buffer = NULL;
     len_scale = 10000;
 //    save_all_br_lens = false;
     duplication_counter = 0;
@@ -99,35 +100,84 @@ void IQTree::setCheckpoint(Checkpoint *checkpoint) {
         (*it)->setCheckpoint(checkpoint);
 }
 
+/**
+    save distinct UFBoot trees into the current struct of checkpoint
+    @param distinct_trees distinct tree strings
+*/
+void saveUFBootTrees(Checkpoint *checkpoint, StrVector &distinct_trees) {
+    int num_trees = distinct_trees.size();
+    CKP_SAVE(num_trees);
+    checkpoint->startStruct("trees");
+    checkpoint->startList(num_trees);
+    for (auto it = distinct_trees.begin(); it != distinct_trees.end(); it++) {
+        checkpoint->addListElement();
+        checkpoint->put("", *it);
+    }
+    checkpoint->endList();
+    checkpoint->endStruct();
+}
+
+/**
+    restore distinct UFBoot trees from the current struct of checkpoint
+    @param[out] distinct_trees distinct tree strings
+*/
+void restoreUFBootTrees(Checkpoint *checkpoint, StrVector &distinct_trees) {
+    int num_trees = 0;
+    CKP_RESTORE(num_trees);
+    distinct_trees.resize(num_trees);
+    checkpoint->startStruct("trees");
+    checkpoint->startList(num_trees);
+    for (auto it = distinct_trees.begin(); it != distinct_trees.end(); it++) {
+        checkpoint->addListElement();
+        checkpoint->getString("", *it);
+    }
+    checkpoint->endList();
+    checkpoint->endStruct();
+}
+
+void IQTree::restoreUFBootSample(int id, string &str, StrVector &distinct_trees) {
+    stringstream ss(str);
+    string tree_str;
+    ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id] >> tree_str;
+    if (tree_str.empty() || tree_str[0] == '(') {
+        // tree string of old checkpoint
+        boot_trees.setTree(id, tree_str);
+    } else {
+        int tree_id = convert_int(tree_str.c_str());
+        boot_trees.setTree(id, (tree_id < 0) ? "" : distinct_trees[tree_id]);
+    }
+}
+
 void IQTree::saveUFBoot(Checkpoint *checkpoint) {
+    flushRELL();
     checkpoint->startStruct("UFBoot");
+    int start = 0, end = boot_samples.size();
     if (MPIHelper::getInstance().isWorker()) {
         CKP_SAVE(sample_start);
         CKP_SAVE(sample_end);
-        checkpoint->startList(boot_samples.size());
-        checkpoint->setListElement(sample_start-1);
-        for (int id = sample_start; id != sample_end; id++) {
-            checkpoint->addListElement();
-            stringstream ss;
-            ss.precision(10);
-            ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << boot_trees[id];
-            checkpoint->put("", ss.str());
-        }
-        checkpoint->endList();
+        start = sample_start;
+        end = sample_end;
     } else {
         CKP_SAVE(logl_cutoff);
         int boot_splits_size = boot_splits.size();
         CKP_SAVE(boot_splits_size);
-        checkpoint->startList(boot_samples.size());
-        for (int id = 0; id != boot_samples.size(); id++) {
-            checkpoint->addListElement();
-            stringstream ss;
-            ss.precision(10);
-            ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << boot_trees[id];
-            checkpoint->put("", ss.str());
-        }
-        checkpoint->endList();
     }
+    // each distinct tree is saved once, samples refer to it by index
+    StrVector distinct_trees;
+    IntVector sample_ids;
+    boot_trees.getDistinctTrees(distinct_trees, sample_ids, start, end);
+    saveUFBootTrees(checkpoint, distinct_trees);
+    checkpoint->startList(boot_samples.size());
+    if (start > 0)
+        checkpoint->setListElement(start-1);
+    for (int id = start; id != end; id++) {
+        checkpoint->addListElement();
+        stringstream ss;
+        ss.precision(10);
+        ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << sample_ids[id-start];
+        checkpoint->put("", ss.str());
+    }
+    checkpoint->endList();
     checkpoint->endStruct();
 }
 
@@ -135,7 +185,7 @@ void IQTree::saveCheckpoint() {
     stop_rule.saveCheckpoint();
     candidateTrees.saveCheckpoint();
     
-    if (boot_samples.size() > 0 && !boot_trees.front().empty()) {
+    if (boot_samples.size() > 0 && !boot_trees[0].empty()) {
         saveUFBoot(checkpoint);
         // boot_splits
         int id = 0;
@@ -159,14 +209,16 @@ void IQTree::restoreUFBoot(Checkpoint *checkpoint) {
     int sample_start, sample_end;
     CKP_RESTORE(sample_start);
     CKP_RESTORE(sample_end);
-    checkpoint->setListElement(sample_start-1);
+    StrVector distinct_trees;
+    restoreUFBootTrees(checkpoint, distinct_trees);
+    if (sample_start > 0)
+        checkpoint->setListElement(sample_start-1);
     for (id = sample_start; id != sample_end; id++) {
         checkpoint->addListElement();
         string str;
         checkpoint->getString("", str);
         ASSERT(!str.empty());
-        stringstream ss(str);
-        ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id] >> boot_trees[id];
+        restoreUFBootSample(id, str, distinct_trees);
     }
     checkpoint->endList();
     checkpoint->endStruct();
@@ -183,6 +235,8 @@ void IQTree::restoreCheckpoint() {
         CKP_RESTORE(logl_cutoff);
         // save boot_samples and boot_trees
         int id = 0;
+        StrVector distinct_trees;
+        restoreUFBootTrees(checkpoint, distinct_trees);
         checkpoint->startList(params->gbo_replicates);
         boot_trees.resize(params->gbo_replicates);
         boot_logl.resize(params->gbo_replicates);
@@ -192,8 +246,7 @@ void IQTree::restoreCheckpoint() {
             checkpoint->addListElement();
             string str;
             checkpoint->getString("", str);
-            stringstream ss(str);
-            ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id] >> boot_trees[id];
+            restoreUFBootSample(id, str, distinct_trees);
         }
         checkpoint->endList();
         int boot_splits_size = 0;
@@ -366,15 +419,20 @@ void IQTree::initSettings(Params &params) {
 #else
         size_t nptn = get_safe_upper_limit(orig_nptn);
 #endif
-        BootValType *mem = aligned_alloc<BootValType>(nptn * (size_t)(params.gbo_replicates));
-        memset(mem, 0, nptn * (size_t)(params.gbo_replicates) * sizeof(BootValType));
-        for (i = 0; i < params.gbo_replicates; i++)
-            boot_samples[i] = mem + i*nptn;
+        if (params.ufboot_compact) {
+            // weights are stored in boot_weights, boot_samples only holds NULL pointers
+            boot_weights.init(params.ufboot_compact, params.gbo_replicates, orig_nptn);
+        } else {
+            BootValType *mem = aligned_alloc<BootValType>(nptn * (size_t)(params.gbo_replicates));
+            memset(mem, 0, nptn * (size_t)(params.gbo_replicates) * sizeof(BootValType));
+            for (i = 0; i < params.gbo_replicates; i++)
+                boot_samples[i] = mem + i*nptn;
+        }
 
         if (boot_trees.empty()) {
             boot_logl.resize(params.gbo_replicates, -DBL_MAX);
             boot_orig_logl.resize(params.gbo_replicates, -DBL_MAX);
-            boot_trees.resize(params.gbo_replicates, "");
+            boot_trees.resize(params.gbo_replicates);
             boot_counts.resize(params.gbo_replicates, 0);
         } else {
             cout << "CHECKPOINT: " << boot_trees.size() << " UFBoot trees and " << boot_splits.size() << " UFBootSplits restored" << endl;
@@ -382,26 +440,28 @@ void IQTree::initSettings(Params &params) {
         VerboseMode saved_mode = verbose_mode;
         verbose_mode = VB_QUIET;
         for (i = 0; i < params.gbo_replicates; i++) {
+            IntVector this_sample;
             if (params.print_bootaln) {
                 Alignment* bootstrap_alignment;
                 if (aln->isSuperAlignment())
                     bootstrap_alignment = new SuperAlignment;
                 else
                     bootstrap_alignment = new Alignment;
-                IntVector this_sample;
                 bootstrap_alignment->createBootstrapAlignment(aln, &this_sample, params.bootstrap_spec);
-                for (size_t j = 0; j < orig_nptn; j++)
-                    boot_samples[i][j] = this_sample[j];
                 bootstrap_alignment->printAlignment(params.aln_output_format, bootaln_name.c_str(), true);
                 delete bootstrap_alignment;
             } else {
-                IntVector this_sample;
                 aln->createBootstrapAlignment(this_sample, params.bootstrap_spec);
+            }
+            if (params.ufboot_compact)
+                boot_weights.setSample(i, this_sample);
+            else
                 for (size_t j = 0; j < orig_nptn; j++)
                     boot_samples[i][j] = this_sample[j];
-            }
         }
         verbose_mode = saved_mode;
+        if (params.ufboot_compact && verbose_mode >= VB_MED)
+            cout << boot_weights.getNumOverflows() << " UFBoot weights exceed " << params.ufboot_compact << " bits" << endl;
         if (params.print_bootaln) {
             cout << "Bootstrap alignments printed to " << bootaln_name << endl;
         }
@@ -420,7 +480,7 @@ void IQTree::initSettings(Params &params) {
             for (size_t i = 0; i < params.gbo_replicates; i++) {
                 boot_samples_int[i].resize(nptn, 0);
                 for (size_t j = 0; j < orig_nptn; j++)
-                    boot_samples_int[i][j] = boot_samples[i][j];
+                    boot_samples_int[i][j] = getBootWeight(i, j);
                }
         }
 
@@ -449,6 +509,11 @@ IQTree::~IQTree() {
         aligned_free(boot_samples[0]); // free memory
         boot_samples.clear();
     }
+    boot_weights.clear();
+    if (rell_buffer) {
+        aligned_free(rell_buffer);
+        rell_buffer = NULL;
+    }
 }
 
 extern const char *aa_model_names_rax[];
@@ -2591,7 +2656,7 @@ void IQTree::refineBootTrees(){
         stringstream ostr;
         printTree(ostr, WT_TAXON_ID | WT_SORT_TAXA);
         tree = ostr.str();
-        boot_trees[sample] = getTreeString();
+        boot_trees.setTree(sample, getTreeString());
         boot_logl[sample] = curScore;
 
         printTree(btreea, WT_NEWLINE | WT_SORT_TAXA);
@@ -2649,6 +2714,7 @@ void IQTree::refineBootTrees(){
  ***********************************************************/
 void IQTree::refineBootTrees() {
 
+    flushRELL();
     int *saved_randstream = randstream;
     init_random(params->ran_seed);
 
@@ -2781,7 +2847,7 @@ void IQTree::refineBootTrees() {
             boot_tree->printTree(ostr, WT_TAXON_ID | WT_SORT_TAXA | WT_BR_LEN | WT_BR_LEN_SHORT);
         else
             boot_tree->printTree(ostr, WT_TAXON_ID | WT_SORT_TAXA);
-        boot_trees[sample] = ostr.str();
+        boot_trees.setTree(sample, ostr.str());
         boot_logl[sample] = boot_tree->curScore;
 
 
@@ -2988,6 +3054,7 @@ pair<int, int> IQTree::doNNISearch(bool write_info) {
             }
         }
     }
+    flushRELL();
     MPIHelper::getInstance().setNumNNISearch(MPIHelper::getInstance().getNumNNISearch() + 1);
 
     return nniInfos;
@@ -3271,7 +3338,7 @@ void IQTree::pllInitUFBootData(){
                 if(!pllUFBootDataPtr->boot_samples[i]) outError("Not enough dynamic memory!");
                 for(int j = 0; j < pllAlignment->sequenceLength; j++){
                     pllUFBootDataPtr->boot_samples[i][j] =
-                        boot_samples[i][pll2iqtree_pattern_index[j]];
+                        getBootWeight(i, pll2iqtree_pattern_index[j]);
                 }
             }
 
@@ -3421,7 +3488,145 @@ void IQTree::setDelete(int _delete) {
     k_delete = _delete;
 }
 
+/** minimum number of patterns per thread for pattern-level parallelism of NNI evaluation */
+const size_t MIN_NNI_PATTERNS_PER_THREAD = 1000;
+
+int IQTree::getNNIBranchThreads(size_t num_branches) {
+#ifdef _OPENMP
+    if (num_threads <= 1 || num_branches < 2 * num_threads)
+        return 1;
+    // these trees need more than the topology and model to evaluate an NNI
+    if (isSuperTree() || isMixlen() || isTreeMix() || rooted || !constraintTree.empty() || save_all_trees == 2)
+        return 1;
+    if (aln->getNPattern() >= MIN_NNI_PATTERNS_PER_THREAD * num_threads)
+        return 1;
+    int nni_threads = num_threads;
+    // each thread needs a copy of the partial likelihoods
+    uint64_t mem_per_tree = getMemoryRequired();
+    while (nni_threads > 1 && mem_per_tree * nni_threads > getMemorySize() / 2)
+        nni_threads--;
+    return nni_threads;
+#else
+    return 1;
+#endif
+}
+
+/**
+    @param tree a tree
+    @param[out] nodes nodes of the tree indexed by node ID
+    @return false if the node IDs are not 0..nodeNum-1
+*/
+static bool getNodesByID(MTree *tree, vector<PhyloNode*> &nodes) {
+    nodes.assign(tree->nodeNum, NULL);
+    if (tree->root->id < 0 || tree->root->id >= tree->nodeNum)
+        return false;
+    NodeVector stack;
+    stack.push_back(tree->root);
+    nodes[tree->root->id] = (PhyloNode*)tree->root;
+    int count = 1;
+    while (!stack.empty()) {
+        Node *node = stack.back();
+        stack.pop_back();
+        FOR_NEIGHBOR_IT(node, NULL, it) {
+            Node *nei_node = (*it)->node;
+            if (nei_node->id < 0 || nei_node->id >= tree->nodeNum)
+                return false;
+            if (nodes[nei_node->id] == nei_node)
+                continue;
+            if (nodes[nei_node->id])
+                return false;
+            nodes[nei_node->id] = (PhyloNode*)nei_node;
+            stack.push_back(nei_node);
+            count++;
+        }
+    }
+    return count == tree->nodeNum;
+}
+
+/**
+    copy the topology and branch lengths of a tree, keeping the node IDs and
+    the order of the neighbors, such that neighbor iterators correspond by index
+    @param source tree to copy
+    @param target empty tree
+    @param[out] target_nodes nodes of target indexed by node ID
+*/
+static void copyTopologyWithIDs(PhyloTree *source, PhyloTree *target, vector<PhyloNode*> &target_nodes) {
+    vector<PhyloNode*> nodes;
+    bool ok = getNodesByID(source, nodes);
+    ASSERT(ok);
+    target_nodes.resize(nodes.size());
+    for (auto node : nodes)
+        target_nodes[node->id] = (PhyloNode*)target->newNode(node->id, node->name.c_str());
+    for (auto node : nodes)
+        FOR_NEIGHBOR_IT(node, NULL, it)
+            target_nodes[node->id]->addNeighbor(target_nodes[(*it)->node->id], (*it)->length, (*it)->id);
+    target->root = target_nodes[source->root->id];
+    target->leafNum = source->leafNum;
+    target->nodeNum = source->nodeNum;
+    target->branchNum = source->branchNum;
+    target->rooted = source->rooted;
+}
+
+bool IQTree::evaluateNNIsInParallel(Branches &nniBranches, vector<NNIMove> &positiveNNIs, int nni_threads) {
+#ifdef _OPENMP
+    vector<PhyloNode*> nodes;
+    if (!getNodesByID(this, nodes))
+        return false;
+    vector<Branch> branches;
+    for (Branches::iterator it = nniBranches.begin(); it != nniBranches.end(); it++)
+        branches.push_back(it->second);
+    vector<NNIMove> moves(branches.size());
+    // consecutive branches share most partial likelihoods, thus static blocks
+#pragma omp parallel num_threads(nni_threads)
+    {
+        PhyloTree *thread_tree = new PhyloTree(aln);
+        vector<PhyloNode*> thread_nodes;
+        copyTopologyWithIDs(this, thread_tree, thread_nodes);
+        thread_tree->setParams(params);
+        thread_tree->optimize_by_newton = optimize_by_newton;
+        thread_tree->setLikelihoodKernel(sse);
+        thread_tree->setNumThreads(1);
+        thread_tree->setModelFactory(getModelFactory());
+        thread_tree->setModel(getModel());
+        thread_tree->setRate(getRate());
+        thread_tree->initializeAllPartialLh();
+        thread_tree->setCurScore(thread_tree->computeLikelihood());
+#pragma omp for schedule(static)
+        for (size_t i = 0; i < branches.size(); i++) {
+            NNIMove nni = thread_tree->getBestNNIForBran(thread_nodes[branches[i].first->id],
+                                                         thread_nodes[branches[i].second->id], NULL);
+            // map the move back to the nodes of this tree
+            moves[i] = nni;
+            moves[i].node1 = nodes[nni.node1->id];
+            moves[i].node2 = nodes[nni.node2->id];
+            moves[i].node1Nei_it = moves[i].node1->neighbors.begin() + (nni.node1Nei_it - nni.node1->neighbors.begin());
+            moves[i].node2Nei_it = moves[i].node2->neighbors.begin() + (nni.node2Nei_it - nni.node2->neighbors.begin());
+        }
+        // model and rate belong to this tree
+        thread_tree->setModelFactory(NULL);
+        thread_tree->setModel(NULL);
+        thread_tree->setRate(NULL);
+        delete thread_tree;
+    }
+    for (auto nni : moves)
+        if (nni.newloglh > curScore)
+            positiveNNIs.push_back(nni);
+
+    // synchronize tree during optimization step
+    if (MPIHelper::getInstance().isMaster() && candidateset_changed.size() > 0
+        && MPIHelper::getInstance().gotMessage()) {
+        syncCurrentTree();
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
 void IQTree::evaluateNNIs(Branches &nniBranches, vector<NNIMove>  &positiveNNIs) {
+    int nni_threads = getNNIBranchThreads(nniBranches.size());
+    if (nni_threads > 1 && evaluateNNIsInParallel(nniBranches, positiveNNIs, nni_threads))
+        return;
     for (Branches::iterator it = nniBranches.begin(); it != nniBranches.end(); it++) {
         NNIMove nni = getBestNNIForBran((PhyloNode*) it->second.first, (PhyloNode*) it->second.second, NULL);
         if (nni.newloglh > curScore) {
@@ -3583,56 +3788,24 @@ void IQTree::saveCurrentTree(double cur_logl) {
 //        int ptn;
 //        int updated = 0;
 //        int nsamples = boot_samples.size();
-        ostringstream ostr;
-        string tree_str;
         setRootNode(params->root);
-        if (params->print_ufboot_trees == 2)
-            printTree(ostr, WT_TAXON_ID + WT_SORT_TAXA + WT_BR_LEN + WT_BR_LEN_SHORT);
-        else
-            printTree(ostr, WT_TAXON_ID + WT_SORT_TAXA);
-        tree_str = ostr.str();
-
-    #ifdef _OPENMP
-        int rand_seed = random_int(1000);
-        #pragma omp parallel
-        {
-        int *rstream;
-        init_random(rand_seed + omp_get_thread_num(), false, &rstream);
-        #pragma omp for
-    #else
-        int *rstream = randstream;
-    #endif
-        for (int sample = sample_start; sample < sample_end; sample++) {
-            double rell = 0.0;
-
-            {
-                // SSE optimized version of the above loop
-                BootValType *boot_sample = boot_samples[sample];
-
-                BootValType res = (this->*dotProduct)(pattern_lh, boot_sample, nptn);
-
-                rell = res;
-            }
-
-            bool better = rell > boot_logl[sample] + params->ufboot_epsilon;
-            if (!better && rell > boot_logl[sample] - params->ufboot_epsilon) {
-                better = (random_double(rstream) <= 1.0 / (boot_counts[sample] + 1));
-            }
-            if (better) {
-                if (rell <= boot_logl[sample] + params->ufboot_epsilon) {
-                    boot_counts[sample]++;
-                } else {
-                    boot_counts[sample] = 1;
-                }
-                boot_logl[sample] = max(boot_logl[sample], rell);
-                boot_orig_logl[sample] = cur_logl;
-                boot_trees[sample] = tree_str;
-            }
-        }
-    #ifdef _OPENMP
-        finish_random(rstream);
+        if (params->ufboot_batch > 1) {
+            // buffer the tree, the buffered trees are scored together once the buffer is full
+            if (!rell_buffer)
+                rell_buffer = aligned_alloc<BootValType>(maxnptn * params->ufboot_batch);
+            memcpy(rell_buffer + rell_buffer_logl.size()*maxnptn, pattern_lh, maxnptn*sizeof(BootValType));
+            rell_buffer_logl.push_back(cur_logl);
+            ostringstream ostr;
+            if (params->print_ufboot_trees == 2)
+                printTree(ostr, WT_TAXON_ID + WT_SORT_TAXA + WT_BR_LEN + WT_BR_LEN_SHORT);
+            else
+                printTree(ostr, WT_TAXON_ID + WT_SORT_TAXA);
+            rell_buffer_trees.push_back(ostr.str());
+            if (rell_buffer_logl.size() >= params->ufboot_batch)
+                flushRELL();
+        } else {
+            updateBootSamples(pattern_lh, 1, maxnptn, &cur_logl, NULL);
         }
-    #endif
     }
     if (Params::getInstance().print_tree_lh) {
         out_treelh << cur_logl;
@@ -3665,6 +3838,103 @@ void IQTree::saveCurrentTree(double cur_logl) {
 
 }
 
+void IQTree::updateBootSamples(BootValType *pattern_lh, int ntrees, size_t stride, double *tree_logl, StrVector *tree_strs) {
+    const int SAMPLE_CHUNK = 64;
+    int nptn = getAlnNPattern();
+    int nsamples = sample_end - sample_start;
+    int nchunks = (nsamples + SAMPLE_CHUNK - 1) / SAMPLE_CHUNK;
+    BootValType *rell_mat = aligned_alloc<BootValType>((size_t)nsamples * ntrees);
+    // the tree adopted by each sample, -1 if the sample is not improved
+    IntVector sample_best(nsamples, -1);
+
+#ifdef _OPENMP
+    int rand_seed = random_int(1000);
+    #pragma omp parallel
+    {
+    int *rstream;
+    init_random(rand_seed + omp_get_thread_num(), false, &rstream);
+    #pragma omp for
+#else
+    int *rstream = randstream;
+#endif
+    for (int chunk = 0; chunk < nchunks; chunk++) {
+        int first = chunk * SAMPLE_CHUNK;
+        (this->*computeRELL)(pattern_lh, ntrees, boot_samples[0], boot_weights.empty() ? NULL : &boot_weights,
+                             sample_start + first, min(SAMPLE_CHUNK, nsamples - first), stride, nptn,
+                             rell_mat + (size_t)first * ntrees);
+    }
+#ifdef _OPENMP
+    #pragma omp for
+#endif
+    for (int sample = sample_start; sample < sample_end; sample++) {
+        BootValType *sample_rell = rell_mat + (size_t)(sample - sample_start) * ntrees;
+        // trees are considered in the order they were visited
+        for (int tree = 0; tree < ntrees; tree++) {
+            double rell = sample_rell[tree];
+            bool better = rell > boot_logl[sample] + params->ufboot_epsilon;
+            if (!better && rell > boot_logl[sample] - params->ufboot_epsilon) {
+                better = (random_double(rstream) <= 1.0 / (boot_counts[sample] + 1));
+            }
+            if (better) {
+                if (rell <= boot_logl[sample] + params->ufboot_epsilon) {
+                    boot_counts[sample]++;
+                } else {
+                    boot_counts[sample] = 1;
+                }
+                boot_logl[sample] = max(boot_logl[sample], rell);
+                boot_orig_logl[sample] = tree_logl[tree];
+                sample_best[sample - sample_start] = tree;
+            }
+        }
+    }
+#ifdef _OPENMP
+    finish_random(rstream);
+    }
+#endif
+    aligned_free(rell_mat);
+
+    // assign trees to improved samples, each tree is printed or inserted only once
+    IntVector tree_ids(ntrees, -1);
+    for (int sample = sample_start; sample < sample_end; sample++) {
+        int tree = sample_best[sample - sample_start];
+        if (tree < 0)
+            continue;
+        if (tree_ids[tree] < 0) {
+            if (tree_strs) {
+                tree_ids[tree] = boot_trees.insertTree(tree_strs->at(tree));
+            } else {
+                ostringstream ostr;
+                if (params->print_ufboot_trees == 2)
+                    printTree(ostr, WT_TAXON_ID + WT_SORT_TAXA + WT_BR_LEN + WT_BR_LEN_SHORT);
+                else
+                    printTree(ostr, WT_TAXON_ID + WT_SORT_TAXA);
+                tree_ids[tree] = boot_trees.insertTree(ostr.str());
+            }
+        }
+        boot_trees.setTreeID(sample, tree_ids[tree]);
+    }
+}
+
+int IQTree::getBootWeight(int sample, int ptn) {
+    if (!boot_weights.empty())
+        return boot_weights.getWeight(sample, ptn);
+    return boot_samples[sample][ptn];
+}
+
+void IQTree::flushRELL() {
+    if (rell_buffer_logl.empty())
+        return;
+    int nptn = getAlnNPattern();
+#ifdef BOOT_VAL_FLOAT
+    size_t maxnptn = get_safe_upper_limit_float(nptn);
+#else
+    size_t maxnptn = get_safe_upper_limit(nptn);
+#endif
+    updateBootSamples(rell_buffer, rell_buffer_logl.size(), maxnptn, &rell_buffer_logl[0], &rell_buffer_trees);
+    rell_buffer_logl.clear();
+    rell_buffer_trees.clear();
+}
+
 void IQTree::saveNNITrees(PhyloNode *node, PhyloNode *dad) {
     if (!node) {
         node = (PhyloNode*) root;
@@ -3789,7 +4059,9 @@ void IQTree::writeUFBootTrees(Params &params) {
     filename += ".ufboot";
     ofstream out(filename.c_str());
 
-    trees.init(boot_trees, rooted);
+    flushRELL();
+    IntVector sample_trees;
+    trees.init(boot_trees, rooted, &sample_trees);
     for (i = 0; i < trees.size(); i++) {
         NodeVector taxa;
         // change the taxa name from ID to real name
@@ -3800,19 +4072,22 @@ void IQTree::writeUFBootTrees(Params &params) {
             // reinsert removed seqs into each tree
             trees[i]->insertTaxa(removed_seqs, twin_seqs);
         }
-        // now print to file
-        for (j = 0; j < trees.tree_weights[i]; j++)
+    }
+    // now print to file in the order of bootstrap samples
+    for (auto it = sample_trees.begin(); it != sample_trees.end(); it++)
+        if (*it >= 0) {
             if (params.print_ufboot_trees == 1)
-                trees[i]->printTree(out, WT_NEWLINE);
+                trees[*it]->printTree(out, WT_NEWLINE);
             else
-                trees[i]->printTree(out, WT_NEWLINE + WT_BR_LEN);
-    }
+                trees[*it]->printTree(out, WT_NEWLINE + WT_BR_LEN);
+        }
     cout << "UFBoot trees printed to " << filename << endl;
     out.close();
 }
 
 void IQTree::summarizeBootstrap(Params &params) {
     setRootNode(params.root);
+    flushRELL();
     MTreeSet trees;
     trees.init(boot_trees, rooted);
     summarizeBootstrap(params, trees);
@@ -3821,6 +4096,7 @@ void IQTree::summarizeBootstrap(Params &params) {
 void IQTree::summarizeBootstrap(SplitGraph &sg) {
     MTreeSet trees;
     //SplitGraph sg;
+    flushRELL();
     trees.init(boot_trees, rooted);
     SplitIntMap hash_ss;
     // make the taxa name
@@ -3901,9 +4177,9 @@ void IQTree::computeRootstrap(MTreeSet &trees, bool use_taxid) {
             if (other.shouldInvert())
                 other.invert();
             // count how often both splits occur in the tree set
-            for (auto splits : ssvec) {
-                if (splits.findSplit(sg[i]) && splits.findSplit(&other)) {
-                    rootstrap++;
+            for (int j = 0; j < ssvec.size(); j++) {
+                if (ssvec[j].findSplit(sg[i]) && ssvec[j].findSplit(&other)) {
+                    rootstrap += trees.tree_weights[j];
                 }
             }
 
@@ -3929,16 +4205,16 @@ void IQTree::computeRootstrap(MTreeSet &trees, bool use_taxid) {
             }
             
             // count how often both splits occur in the tree set
-            for (auto splits : ssvec) {
-                if (splits.findSplit(left) && splits.findSplit(right)) {
-                    rootstrap++;
+            for (int j = 0; j < ssvec.size(); j++) {
+                if (ssvec[j].findSplit(left) && ssvec[j].findSplit(right)) {
+                    rootstrap += trees.tree_weights[j];
                 }
             }
             delete right;
             delete left;
         }
         
-        double rootstrap_dbl = (double)rootstrap*100.0 / trees.size();
+        double rootstrap_dbl = (double)rootstrap*100.0 / trees.sumTreeWeights();
         //branch.first->findNeighbor(branch.second)->putAttr("rootstrap", rootstrap_dbl);
         Neighbor *nei = branch.second->findNeighbor(branch.first);
         nei->putAttr("rootstrap", rootstrap_dbl);
@@ -4131,8 +4407,9 @@ void IQTree::pllConvertUFBootData2IQTree(){
 
     //boot_trees
     boot_trees.clear();
+    boot_trees.resize(params->gbo_replicates);
     for(int i = 0; i < params->gbo_replicates; i++)
-        boot_trees.push_back(pllUFBootDataPtr->boot_trees[i]);
+        boot_trees.setTree(i, pllUFBootDataPtr->boot_trees[i]);
 
 }
 
@@ -30,6 +30,7 @@
 #include "phylonode.h"
 #include "utils/stoprule.h"
 #include "mtreeset.h"
+#include "bootweights.h"
 #include "node.h"
 #include "candidateset.h"
 #include "utils/pllnni.h"
@@ -126,6 +127,14 @@ public:
     */
     void restoreUFBoot(Checkpoint *checkpoint);
 
+    /**
+        restore one UFBoot sample from its checkpoint line
+        @param id sample ID
+        @param str checkpoint line "count logl orig_logl tree", tree is an index into distinct_trees
+        @param distinct_trees distinct trees of the checkpoint
+    */
+    void restoreUFBootSample(int id, string &str, StrVector &distinct_trees);
+
     /**
      * setup all necessary parameters  (declared as virtual needed for phylosupertree)
      */
@@ -449,6 +458,27 @@ public:
      */
     void evaluateNNIs(Branches &nniBranches, vector<NNIMove> &outNNIMoves);
 
+    /**
+     * @brief decide between branch-level and pattern-level parallelism for evaluating NNIs.
+     * Branch-level parallelism pays off if the alignment is too short to keep
+     * all threads busy inside the likelihood kernel.
+     *
+     * @param num_branches number of branches to evaluate
+     * @return number of threads evaluating branches concurrently, 1 for pattern-level parallelism
+     */
+    int getNNIBranchThreads(size_t num_branches);
+
+    /**
+     * @brief Evaluate NNIs on different branches concurrently. Each thread works on its own
+     * copy of the tree with the same node IDs and its own partial likelihoods
+     *
+     * @param nniBranches [IN] branches the branches on which NNIs will be evaluated
+     * @param outNNIMoves [OUT] positive NNIs in the order of the branches
+     * @param nni_threads number of threads
+     * @return false if the tree cannot be copied, nothing is evaluated then
+     */
+    bool evaluateNNIsInParallel(Branches &nniBranches, vector<NNIMove> &outNNIMoves, int nni_threads);
+
     double optimizeNNIBranches(Branches &nniBranches);
 
     /**
@@ -771,17 +801,27 @@ public:
     /** log-likelihood threshold (l_min) */
     double logl_cutoff;
 
-    /** vector of bootstrap alignments generated */
+    /** vector of bootstrap alignments generated, NULL pointers if boot_weights is used */
     vector<BootValType* > boot_samples;
 
+    /** pattern weights of bootstrap alignments as small integers (--ufboot-compact) */
+    BootWeights boot_weights;
+
+    /**
+        @param sample bootstrap sample ID
+        @param ptn pattern ID
+        @return weight of the pattern in the bootstrap sample
+    */
+    int getBootWeight(int sample, int ptn);
+
     /** starting sample for UFBoot, used for MPI */
     int sample_start;
 
     /** end sample for UFBoot, used for MPI */
     int sample_end;
 
-    /** newick string of corresponding bootstrap trees */
-    StrVector boot_trees;
+    /** newick string of corresponding bootstrap trees, each distinct tree stored once */
+    BootTreeSet boot_trees;
 
     /** bootstrap tree strings with branch lengths, for -wbtl option */
 //    StrVector boot_trees_brlen;
@@ -867,6 +907,28 @@ protected:
 
     virtual void saveCurrentTree(double logl); // save current tree
 
+    /**
+        update the UFBoot samples with candidate trees by RELL
+        @param pattern_lh pattern log-likelihoods of the trees, one row per tree
+        @param ntrees number of trees
+        @param stride distance between two rows of pattern_lh
+        @param tree_logl log-likelihood of each tree on the original alignment
+        @param tree_strs tree strings, NULL if there is only the current tree
+    */
+    void updateBootSamples(BootValType *pattern_lh, int ntrees, size_t stride, double *tree_logl, StrVector *tree_strs);
+
+    /** update the UFBoot samples with the trees buffered by saveCurrentTree (--ufboot-batch) */
+    void flushRELL();
+
+    /** pattern log-likelihoods of candidate trees not yet evaluated on the UFBoot samples */
+    BootValType *rell_buffer;
+
+    /** log-likelihoods of the buffered trees */
+    DoubleVector rell_buffer_logl;
+
+    /** tree strings of the buffered trees */
+    StrVector rell_buffer_trees;
+
 
     void saveNNITrees(PhyloNode *node = NULL, PhyloNode *dad = NULL);
 
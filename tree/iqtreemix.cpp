@@ -57,6 +57,7 @@ IQTreeMix::IQTreeMix() : IQTree() {
     anySiteRate = false;
     isNestedOpenmp = false;
     rhas_var = NULL;
+    ntree = 0;
 }
 
 IQTreeMix::IQTreeMix(Params &params, Alignment *aln, vector<IQTree*> &trees) : IQTree(aln) {
@@ -88,6 +89,7 @@ IQTreeMix::IQTreeMix(Params &params, Alignment *aln, vector<IQTree*> &trees) : I
     ptn_like_cat = aligned_alloc<double>(block_size);
     _ptn_like_cat = aligned_alloc<double>(block_size);
     ptn_scale_cat = aligned_alloc<double>(block_size);
+    tree_lh_status.assign(ntree, TREE_LH_OUTDATED);
     patn_parsimony = aligned_alloc<int>(block_size32);
     single_ptn_tree_like = aligned_alloc<double>(get_safe_upper_limit(ntree));
     ptn_like = aligned_alloc<double>(mem_size);
@@ -574,6 +576,7 @@ void IQTreeMix::initializeModel(Params &params, string model_name, ModelsBlock *
             }
 //        }
     }
+    setTreeLhOutdated();
 }
 
 int IQTreeMix::getNumLhCat(SiteLoglType wsl) {
@@ -628,6 +631,7 @@ void IQTreeMix::computeSiteTreeLogLike(int update_which_tree) {
     at(t)->initializeAllPartialLh();
     at(t)->clearAllPartialLH();
     at(t)->computeLikelihood(patternlh_tree, false);
+    tree_lh_status[t] = TREE_LH_REUSABLE;
     // set back the prevoius site rate's tree
     at(t)->getRate()->setTree(ptree);
 
@@ -699,6 +703,7 @@ double IQTreeMix::computeLikelihood(double *pattern_lh, bool save_log_value) {
     }
 
     // compute likelihood for each tree
+    // the still valid partial likelihoods of a tree are reused, unless the tree is outdated
     #pragma omp parallel for schedule(static) num_threads(ntree) if (isNestedOpenmp)
     for (size_t t=0; t<ntree; t++) {
         if (isNestedOpenmp) {
@@ -716,9 +721,12 @@ double IQTreeMix::computeLikelihood(double *pattern_lh, bool save_log_value) {
             copyRHASfrTree0(t);
         }
         
-        at(t)->initializeAllPartialLh();
-        at(t)->clearAllPartialLH();
+        if (tree_lh_status[t] == TREE_LH_OUTDATED) {
+            at(t)->initializeAllPartialLh();
+            at(t)->clearAllPartialLH();
+        }
         at(t)->computeLikelihood(pattern_lh_tree, false);
+        tree_lh_status[t] = TREE_LH_REUSABLE;
         // set back the prevoius site rate's tree
         at(t)->getRate()->setTree(ptree);
     }
@@ -834,6 +842,7 @@ double IQTreeMix::computePatternLhCat(SiteLoglType wsl) {
             at(t)->initializeAllPartialLh();
             at(t)->clearAllPartialLH();
             at(t)->computeLikelihood(pattern_lh_tree, save_log_value);
+            tree_lh_status[t] = TREE_LH_REUSABLE;
             // set back the prevoius site rate's tree
             at(t)->getRate()->setTree(ptree);
         }
@@ -1078,6 +1087,7 @@ void IQTreeMix::computePatternLikelihood(double *pattern_lh, double *cur_logl,
         at(t)->initializeAllPartialLh();
         at(t)->clearAllPartialLH();
         at(t)->computeLikelihood(pattern_lh_tree, false);
+        tree_lh_status[t] = TREE_LH_REUSABLE;
         // set back the prevoius site rate's tree
         at(t)->getRate()->setTree(ptree);
     }
@@ -1147,6 +1157,7 @@ void IQTreeMix::initializeAllPartialLh() {
     for (i=0; i<size(); i++) {
         at(i)->initializeAllPartialLh();
     }
+    setTreeLhOutdated();
 }
 
 void IQTreeMix::deleteAllPartialLh() {
@@ -1154,6 +1165,7 @@ void IQTreeMix::deleteAllPartialLh() {
     for (i=0; i<size(); i++) {
         at(i)->deleteAllPartialLh();
     }
+    setTreeLhOutdated();
 }
 
 void IQTreeMix::clearAllPartialLH(bool make_null) {
@@ -1161,6 +1173,14 @@ void IQTreeMix::clearAllPartialLH(bool make_null) {
     for (i=0; i<size(); i++) {
         at(i)->clearAllPartialLH(make_null);
     }
+    setTreeLhOutdated();
+}
+
+void IQTreeMix::setTreeLhOutdated(int t) {
+    if (t < 0)
+        tree_lh_status.assign(ntree, TREE_LH_OUTDATED);
+    else
+        tree_lh_status[t] = TREE_LH_OUTDATED;
 }
 
 /**
@@ -1193,6 +1213,7 @@ void IQTreeMix::optimizeAllBranchesOneTree(int whichtree, int my_iterations, dou
     ptree = at(whichtree)->getRate()->getTree();
     at(whichtree)->getRate()->setTree(at(whichtree));
     at(whichtree)->optimizeAllBranches(my_iterations, tolerance, maxNRStep);
+    setTreeLhOutdated(whichtree);
     // restore the tree of the site rate
     at(whichtree)->getRate()->setTree(ptree);
 }
@@ -1288,7 +1309,26 @@ void IQTreeMix::setBranchLengths(vector<DoubleVector> &len, Node *node, Node *da
     size_t i;
 
     for (i=0; i<ntree; i++) {
-        at(i)->restoreBranchLengths(len[i]);
+        restoreChangedBranchLengths(at(i), len[i]);
+    }
+}
+
+void IQTreeMix::restoreChangedBranchLengths(PhyloTree *tree, DoubleVector &lenvec, PhyloNode *node, PhyloNode *dad) {
+    if (!node) {
+        node = (PhyloNode*) tree->root;
+        ASSERT(!lenvec.empty());
+    }
+    FOR_NEIGHBOR_IT(node, dad, it) {
+        PhyloNode *child = (PhyloNode*) (*it)->node;
+        double len = lenvec[(*it)->id];
+        if ((*it)->length != len) {
+            (*it)->length = len;
+            child->findNeighbor(node)->length = len;
+            // clear the partial likelihoods of all subtrees containing this branch
+            node->clearReversePartialLh(child);
+            child->clearReversePartialLh(node);
+        }
+        restoreChangedBranchLengths(tree, lenvec, child, node);
     }
 }
 
@@ -1519,6 +1559,7 @@ void IQTreeMix::setRootNode(const char *my_root, bool multi_taxa) {
     for (i=0; i<size(); i++) {
         at(i)->setRootNode(my_root, multi_taxa);
     }
+    setTreeLhOutdated();
 }
 
 /**
@@ -1743,6 +1784,7 @@ void IQTreeMix::computeInitialTree(LikelihoodKernel kernel, istream* in) {
     }
     
     fin.close();
+    setTreeLhOutdated();
     
     // show trees
     // showTree();
@@ -1880,6 +1922,8 @@ void IQTreeMix::optimizeTreeSeparately(int k, bool printInfo, double logl_epsilo
         prev_score = score;
     }
     
+    setTreeLhOutdated(k);
+
     // restore the trees
     at(k)->getRate()->setTree(ptree);
     if (anySiteRate)
@@ -2269,6 +2313,7 @@ string IQTreeMix::optimizeModelParameters(bool printInfo, double logl_epsilon) {
                         is_ptnfrq_posterior = false;
                     }
                     models[0]->optimizeParameters(gradient_epsilon);
+                    setTreeLhOutdated();
                     if (verbose_mode >= VB_MED) {
                         score = computeLikelihood();
                         cout << "after optimizing linked subsitution model, likelihood = " << score << endl;
@@ -2287,6 +2332,7 @@ string IQTreeMix::optimizeModelParameters(bool printInfo, double logl_epsilon) {
                         // call computeFreqArray() after each optimizeParameters()
                         for (i=0; i<ntree; i++) {
                             models[i]->optimizeParameters(gradient_epsilon);
+                            setTreeLhOutdated(i);
                             computeFreqArray(pattern_mix_lh, true, i);
                         }
                     } else {
@@ -2301,6 +2347,7 @@ string IQTreeMix::optimizeModelParameters(bool printInfo, double logl_epsilon) {
                                 omp_set_num_threads(at(k)->num_threads);
                             }
                             models[k]->optimizeParameters(gradient_epsilon);
+                            setTreeLhOutdated(k);
                         }
                         if (isNestedOpenmp) {
                             // omp_set_nested(0);
@@ -2369,6 +2416,7 @@ string IQTreeMix::optimizeModelParameters(bool printInfo, double logl_epsilon) {
                 }
                 site_rates[0]->setTree(this);
                 site_rates[0]->optimizeParameters(gradient_epsilon);
+                setTreeLhOutdated();
                 if (verbose_mode >= VB_MED) {
                     score = computeLikelihood();
                     cout << "after optimizing linked site rate model, likelihood = " << score << endl;
@@ -2385,6 +2433,7 @@ string IQTreeMix::optimizeModelParameters(bool printInfo, double logl_epsilon) {
                     // call computeFreqArray() after each optimizeParameters()
                     for (i=0; i<ntree; i++) {
                         site_rates[i]->optimizeParameters(gradient_epsilon);
+                        setTreeLhOutdated(i);
                         computeFreqArray(pattern_mix_lh, true, i);
                     }
                 /* } else {
@@ -2681,6 +2730,7 @@ void IQTreeMix::readTreeString(const string &tree_string) {
     for (i=0; i<size(); i++) {
         at(i)->readTreeString(substrs[i]);
     }
+    setTreeLhOutdated();
 }
 
 /*
@@ -29,6 +29,11 @@
 #define TINY_SCALE_DIFF 0.5
 #define ONE_LOG_SCALE_DIFF 178.0
 
+// status of the partial likelihoods of a tree inside IQTreeMix
+// TREE_LH_OUTDATED: clear all partial likelihoods and recompute the tree from scratch
+// TREE_LH_REUSABLE: the partial likelihoods not cleared by parameter changes are reused
+enum TreeLhStatus {TREE_LH_OUTDATED, TREE_LH_REUSABLE};
+
 class IQTreeMix : public IQTree, public vector<IQTree*> {
 public:
     
@@ -85,6 +90,13 @@ public:
     
     virtual void clearAllPartialLH(bool make_null = false);
 
+    /**
+     mark the partial likelihoods of a tree as outdated,
+     so that the next computeLikelihood() recomputes that tree from scratch
+     @param t tree index, -1 for all trees
+     */
+    void setTreeLhOutdated(int t = -1);
+
     /**
             compute pattern posterior probabilities per rate/mixture category
             @param pattern_prob_cat (OUT) all pattern-probabilities per category
@@ -120,6 +132,7 @@ public:
     void getBranchLengths(vector<DoubleVector> &len, Node *node = NULL, Node *dad = NULL);
     
     // restore branch lengths of all trees
+    // only the partial likelihoods affected by the changed branches are cleared
     // node and dad are always NULL
     void setBranchLengths(vector<DoubleVector> &len, Node *node = NULL, Node *dad = NULL);
     
@@ -442,6 +455,15 @@ protected:
     // The array rhas_var should have stored the updated RHAS variables of tree 0
     void copyRHASfrTree0(int t);
 
+    /**
+     set the branch lengths of one tree and clear the partial likelihoods affected by the changed branches
+     @param tree one of the trees
+     @param lenvec branch lengths indexed by branch ID
+     @param node the starting node, NULL to start from the root
+     @param dad dad of the node, used to direct the search
+     */
+    void restoreChangedBranchLengths(PhyloTree *tree, DoubleVector &lenvec, PhyloNode *node = NULL, PhyloNode *dad = NULL);
+
     // -------------------------------------
     // for BFGS optimzation on tree weights
     // -------------------------------------
@@ -469,6 +491,11 @@ protected:
      immediate array for pattern likelihoods during computation
      */
     double* _ptn_like_cat;
+
+    /**
+     status of the partial likelihoods of each tree
+     */
+    vector<TreeLhStatus> tree_lh_status;
     
     /**
      number of optimization steps, default: number of Trees * 2
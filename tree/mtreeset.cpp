@@ -141,6 +141,23 @@ void MTreeSet::init(StrVector &treels, bool &is_rooted) {
 	//tree_weights.resize(size(), 1);
 }
 
+void MTreeSet::init(BootTreeSet &boot_trees, bool &is_rooted, IntVector *sample_trees) {
+	StrVector distinct_trees;
+	IntVector sample_ids;
+	boot_trees.getDistinctTrees(distinct_trees, sample_ids);
+	size_t first = size();
+	init(distinct_trees, is_rooted);
+	for (size_t i = first; i < size(); i++)
+		tree_weights[i] = 0;
+	for (IntVector::iterator it = sample_ids.begin(); it != sample_ids.end(); it++)
+		if (*it >= 0) {
+			*it += first;
+			tree_weights[*it]++;
+		}
+	if (sample_trees)
+		*sample_trees = sample_ids;
+}
+
 void MTreeSet::init(vector<string> &trees, vector<string> &taxonNames, bool &is_rooted) {
 	int count = 0;
 	for (vector<string>::iterator it = trees.begin(); it != trees.end(); it++) {
@@ -607,6 +624,117 @@ void MTreeSet::computeRFDist(double *rfdist, int mode, double weight_threshold)
 }
 
 
+void MTreeSet::buildSplitIndex(TreeSplitIndex &index, double weight_threshold, MTreeSet *treeset2) {
+	vector<string> taxname(front()->leafNum);
+	front()->getTaxaName(taxname);
+	vector<MTree*> trees(begin(), end());
+	if (treeset2)
+		trees.insert(trees.end(), treeset2->begin(), treeset2->end());
+	int ntrees = trees.size();
+	index.num_taxa = taxname.size();
+	index.tree_splits.resize(ntrees);
+	index.kept_splits.resize(ntrees);
+	index.all_kept.resize(ntrees, true);
+	index.num_trivial.resize(ntrees, 0);
+
+	// convert a block of trees in parallel, then intern their splits
+	const int block_size = 256;
+	vector<SplitGraph*> sg_vec(block_size, NULL);
+	for (int first = 0; first < ntrees; first += block_size) {
+		int count = min(block_size, ntrees - first);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int i = 0; i < count; i++) {
+			sg_vec[i] = new SplitGraph();
+			trees[first+i]->convertSplits(taxname, *sg_vec[i]);
+		}
+		for (int i = 0; i < count; i++) {
+			int id = first + i;
+			SplitGraph *sg = sg_vec[i];
+			IntVector &ids = index.tree_splits[id];
+			IntVector &kept = index.kept_splits[id];
+			index.num_trivial[id] = sg->getNTrivialSplits();
+			for (SplitGraph::iterator sit = sg->begin(); sit != sg->end(); sit++) {
+				// make sure that taxon 0 is included
+				if (!(*sit)->containTaxon(0)) (*sit)->invert();
+				double weight = (*sit)->getWeight();
+				int split_id;
+				if (!index.split_ids.findSplit(*sit, split_id)) {
+					// the index takes over the split
+					split_id = index.splits.size();
+					index.splits.push_back(*sit);
+					index.split_ids.insertSplit(*sit, split_id);
+					*sit = NULL;
+				}
+				ids.push_back(split_id);
+				if (weight >= weight_threshold)
+					kept.push_back(split_id);
+			}
+			sort(ids.begin(), ids.end());
+			ids.erase(unique(ids.begin(), ids.end()), ids.end());
+			sort(kept.begin(), kept.end());
+			kept.erase(unique(kept.begin(), kept.end()), kept.end());
+			if (kept.size() == ids.size())
+				IntVector().swap(kept);
+			else
+				index.all_kept[id] = false;
+			delete sg;
+			sg_vec[i] = NULL;
+		}
+	}
+}
+
+void MTreeSet::computeRFDistRows(TreeSplitIndex &index, int first_row, int num_rows,
+	int first_col, int num_cols, bool normalize, double *rfdist)
+{
+	size_t num_words = (index.splits.size() + 63) / 64;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+		// splits of the tree of the row, and those of them that are kept
+		vector<uint64_t> row_splits(num_words, 0), row_kept(num_words, 0);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+		for (int row = 0; row < num_rows; row++) {
+			int id = first_row + row;
+			const IntVector &ids = index.tree_splits[id];
+			const IntVector &kept = index.getKeptSplits(id);
+			for (int split_id : ids)
+				row_splits[split_id >> 6] |= (uint64_t)1 << (split_id & 63);
+			for (int split_id : kept)
+				row_kept[split_id >> 6] |= (uint64_t)1 << (split_id & 63);
+			for (int col = 0; col < num_cols; col++) {
+				int id2 = first_col + col;
+				double &rf_val = rfdist[(size_t)row*num_cols + col];
+				if (id2 == id) {
+					rf_val = 0;
+					continue;
+				}
+				const IntVector &ids2 = index.tree_splits[id2];
+				// kept splits of one tree missing in the other, in both directions
+				int common_kept = 0, diff_splits = 0;
+				for (int split_id : ids2)
+					if ((row_kept[split_id >> 6] >> (split_id & 63)) & 1)
+						common_kept++;
+				for (int split_id : index.getKeptSplits(id2))
+					if (!((row_splits[split_id >> 6] >> (split_id & 63)) & 1))
+						diff_splits++;
+				rf_val = diff_splits + (int)kept.size() - common_kept;
+				if (normalize) {
+					int non_trivial = ids.size() - index.num_trivial[id];
+					non_trivial += ids2.size() - index.num_taxa;
+					rf_val /= non_trivial;
+				}
+			}
+			for (int split_id : ids)
+				row_splits[split_id >> 6] = row_kept[split_id >> 6] = 0;
+		}
+	}
+}
+
 void MTreeSet::computeRFDist(double *rfdist, MTreeSet *treeset2, bool k_by_k,
 	const char *info_file, const char *tree_file, double *incomp_splits)
 {
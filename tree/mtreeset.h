@@ -23,9 +23,42 @@
 #include "mtree.h"
 #include "pda/splitgraph.h"
 #include "alignment/alignment.h"
+#include "boottreeset.h"
 
 void readIntVector(const char *file_name, int burnin, int max_count, IntVector &vec);
 
+/**
+    splits of a set of trees interned into one table of distinct splits,
+    such that each tree is the sorted list of the IDs of its splits
+*/
+struct TreeSplitIndex {
+    /** distinct splits, all containing taxon 0 */
+    SplitGraph splits;
+
+    /** map from each distinct split to its ID */
+    SplitIntMap split_ids;
+
+    /** sorted IDs of the splits of each tree */
+    vector<IntVector> tree_splits;
+
+    /** true if all splits of a tree have at least the weight threshold */
+    BoolVector all_kept;
+
+    /** sorted IDs of the splits with at least the weight threshold, empty if all_kept */
+    vector<IntVector> kept_splits;
+
+    /** number of trivial splits of each tree */
+    IntVector num_trivial;
+
+    /** number of taxa */
+    int num_taxa;
+
+    /** @return IDs of the splits of the tree with at least the weight threshold */
+    const IntVector &getKeptSplits(int tree) const {
+        return all_kept[tree] ? tree_splits[tree] : kept_splits[tree];
+    }
+};
+
 /**
 Set of trees
 
@@ -60,6 +93,15 @@ public:
 
 	void init(StrVector &treels, bool &is_rooted);
 
+	/**
+		initialize the tree set from UFBoot trees, each distinct tree is read once
+		and weighted by the number of bootstrap samples having it
+		@param boot_trees UFBoot trees
+		@param is_rooted (IN/OUT) true if tree is rooted
+		@param[out] sample_trees if not NULL, index of the tree of each sample, -1 if none
+	*/
+	void init(BootTreeSet &boot_trees, bool &is_rooted, IntVector *sample_trees = NULL);
+
 	/**
 	 *  Add trees from \a trees to the tree set
 	 *
@@ -174,6 +216,30 @@ public:
 	void computeRFDist(double *rfdist, MTreeSet *treeset2, bool k_by_k,
 		const char* info_file = NULL, const char *tree_file = NULL, double *incomp_splits = NULL);
 
+	/**
+		intern the splits of all trees, followed by those of treeset2, into one index of
+		distinct splits; the trees are converted into splits in parallel blocks
+		@param[out] index the split index
+		@param weight_threshold splits with lower weight are not kept, see computeRFDist()
+		@param treeset2 second tree set, or NULL
+	*/
+	void buildSplitIndex(TreeSplitIndex &index, double weight_threshold, MTreeSet *treeset2 = NULL);
+
+	/**
+		compute rows of Robinson-Foulds distances on a split index, in parallel over the rows.
+		The splits of the tree of a row are marked in bitsets over the split IDs, such that
+		each split of another tree is looked up with one bit test.
+		@param index split index
+		@param first_row ID of the tree of the first row
+		@param num_rows number of rows
+		@param first_col ID of the tree of the first column
+		@param num_cols number of columns
+		@param normalize TRUE to divide by the number of non-trivial splits of both trees
+		@param[out] rfdist num_rows * num_cols distances
+	*/
+	static void computeRFDistRows(TreeSplitIndex &index, int first_row, int num_rows,
+		int first_col, int num_cols, bool normalize, double *rfdist);
+
 	int categorizeDistinctTrees(IntVector &category);
 
 	int sumTreeWeights();
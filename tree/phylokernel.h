@@ -10,6 +10,7 @@
 
 #include "phylotree.h"
 #include "alignment/superalignment.h"
+#include "bootweights.h"
 #if defined(CLANG_UNDER_VS)
 #   define _mm_popcnt_u64 __popcnt64
 #endif
@@ -69,6 +70,54 @@ Numeric PhyloTree::dotProductSIMD(Numeric *x, Numeric *y, int size) {
     return horizontal_add(res);
 }
 
+template <class Numeric, class VectorClass>
+void PhyloTree::computeRELLSIMD(Numeric *pattern_lh, int ntrees, Numeric *samples, BootWeights *weights,
+                                int first_sample, int nsamples, size_t stride, int nptn, Numeric *rell) {
+    // a block of samples is scored against a block of patterns of all trees at a time,
+    // such that the pattern block of the trees stays in cache while the sample rows stream
+    const int SAMPLE_BLOCK = 16;
+    const int PATTERN_BLOCK = 1024;
+    size_t VCSIZE = VectorClass::size();
+    Numeric *acc = aligned_alloc<Numeric>(SAMPLE_BLOCK*ntrees*VCSIZE);
+    // compact weights of one sample and pattern block decoded into BootValType
+    Numeric *decoded = NULL;
+    if (weights)
+        decoded = aligned_alloc<Numeric>(PATTERN_BLOCK);
+    for (int s0 = 0; s0 < nsamples; s0 += SAMPLE_BLOCK) {
+        int s1 = min(s0 + SAMPLE_BLOCK, nsamples);
+        for (int i = 0; i < (s1-s0)*ntrees; i++)
+            VectorClass(0.0).store_a(&acc[i*VCSIZE]);
+        for (int p0 = 0; p0 < nptn; p0 += PATTERN_BLOCK) {
+            int p1 = min(p0 + PATTERN_BLOCK, nptn);
+            for (int s = s0; s < s1; s++) {
+                Numeric *y;
+                if (weights) {
+                    weights->decode(first_sample + s, p0, p1, decoded);
+                    for (int i = p1-p0; i < PATTERN_BLOCK && i % VCSIZE != 0; i++)
+                        decoded[i] = 0;
+                    y = decoded;
+                } else {
+                    y = samples + (first_sample + s)*stride + p0;
+                }
+                Numeric *acc_sample = acc + (s-s0)*ntrees*VCSIZE;
+                for (int t = 0; t < ntrees; t++) {
+                    Numeric *x = pattern_lh + t*stride + p0;
+                    VectorClass res;
+                    res.load_a(&acc_sample[t*VCSIZE]);
+                    for (int i = 0; i < p1-p0; i += VCSIZE)
+                        res = mul_add(VectorClass().load_a(&x[i]), VectorClass().load_a(&y[i]), res);
+                    res.store_a(&acc_sample[t*VCSIZE]);
+                }
+            }
+        }
+        for (int s = s0; s < s1; s++)
+            for (int t = 0; t < ntrees; t++)
+                rell[s*ntrees+t] = horizontal_add(VectorClass().load_a(&acc[((s-s0)*ntrees+t)*VCSIZE]));
+    }
+    aligned_free(decoded);
+    aligned_free(acc);
+}
+
 /************************************************************************************************
  *
  *   Highly optimized vectorized versions of likelihood functions
@@ -1882,8 +1931,9 @@ void PhyloTree::computePartialParsimonySankoffSIMD(PhyloNeighbor *dad_branch, Ph
                             *tip_buffer_ptr = partial_pars_child_ptr[j];
                     }
                     
+                    // tip_buffer was filled through UINT pointers, load_a keeps those stores visible
                     for (int i = 0; i < nstates; i++){
-                        partial_pars_ptr[i] += tip_buffer[i];
+                        partial_pars_ptr[i] += VectorClass().load_a((UINT*)&tip_buffer[i]);
                     }
                 } else {
                     // internal node
@@ -1928,7 +1978,7 @@ void PhyloTree::computePartialParsimonySankoffSIMD(PhyloNeighbor *dad_branch, Ph
             
             for (int i = 0; i < nstates; i++){
                 // min(j->i) from child_branch
-                partial_pars_ptr[i] = tip_buffer[i] + tip_buffer_right[i];
+                partial_pars_ptr[i] = VectorClass().load_a((UINT*)&tip_buffer[i]) + VectorClass().load_a((UINT*)&tip_buffer_right[i]);
             }
         }
     } else if (left->node->isLeaf() && !right->node->isLeaf()) {
@@ -1958,7 +2008,7 @@ void PhyloTree::computePartialParsimonySankoffSIMD(PhyloNeighbor *dad_branch, Ph
                 for(int j = 1; j < nstates; j++) {
                     right_contrib = min(right_ptr[j] + cost_matrix_ptr[j], right_contrib);
                 }
-                partial_pars_ptr[i] = tip_buffer[i] + right_contrib;
+                partial_pars_ptr[i] = VectorClass().load_a((UINT*)&tip_buffer[i]) + right_contrib;
                 cost_matrix_ptr += nstates;
             }
         }
@@ -2044,12 +2094,15 @@ int PhyloTree::computeParsimonyBranchSankoffSIMD(PhyloNeighbor *dad_branch, Phyl
                 }
             }
             VectorClass *dad_branch_ptr = (VectorClass*)&dad_branch->partial_pars[ptn_start_index];
-            VectorClass min_ptn_pars = tip_buffer[0] + dad_branch_ptr[0];
-            VectorClass br_ptn_pars = tip_buffer[0];
+            // tip_buffer was filled through UINT pointers, load_a keeps those stores visible
+            VectorClass tip_value = VectorClass().load_a((UINT*)&tip_buffer[0]);
+            VectorClass min_ptn_pars = tip_value + dad_branch_ptr[0];
+            VectorClass br_ptn_pars = tip_value;
             for (int i = 1; i < nstates; i++){
                 // min(j->i) from node_branch
-                VectorClass min_score = tip_buffer[i] + dad_branch_ptr[i];
-                br_ptn_pars = select(min_score < min_ptn_pars, tip_buffer[i], br_ptn_pars);
+                tip_value.load_a((UINT*)&tip_buffer[i]);
+                VectorClass min_score = tip_value + dad_branch_ptr[i];
+                br_ptn_pars = select(min_score < min_ptn_pars, tip_value, br_ptn_pars);
                 min_ptn_pars = min(min_ptn_pars, min_score);
             }
             //_pattern_pars[ptn] = min_ptn_pars;
@@ -2091,4 +2144,138 @@ int PhyloTree::computeParsimonyBranchSankoffSIMD(PhyloNeighbor *dad_branch, Phyl
     return horizontal_add(tree_pars);
 }
 
+/****************************************************************************
+ Parsimony of a subtree joined to or inserted into a branch outside the tree
+ ****************************************************************************/
+
+template<class VectorClass>
+void PhyloTree::computePartialParsimonyJoinFastSIMD(PhyloNeighbor *left_branch, PhyloNeighbor *right_branch, UINT *partial_pars) {
+    int nstates = aln->getMaxNumStates();
+    const int NUM_BITS = VectorClass::size() * UINT_BITS;
+    size_t nsites = (aln->num_parsimony_sites+NUM_BITS-1)/NUM_BITS;
+    size_t entry_size = nstates * VectorClass::size();
+    UINT *left = left_branch->partial_pars, *right = right_branch->partial_pars;
+    UINT score = 0;
+
+    for (size_t site = 0; site < nsites; site++) {
+        size_t offset = entry_size*site;
+        VectorClass *x = (VectorClass*)(left + offset);
+        VectorClass *y = (VectorClass*)(right + offset);
+        VectorClass *z = (VectorClass*)(partial_pars + offset);
+        VectorClass w = 0;
+        int i;
+        for (i = 0; i < nstates; i++) {
+            z[i] = x[i] & y[i];
+            w |= z[i];
+        }
+        w = ~w;
+        for (i = 0; i < nstates; i++) {
+            z[i] |= w & (x[i] | y[i]);
+        }
+        score += fast_popcount(w);
+    }
+    partial_pars[nstates*VectorClass::size()*nsites] = score + left[entry_size*nsites] + right[entry_size*nsites];
+}
+
+template<class VectorClass>
+int PhyloTree::computeParsimonyInsertFastSIMD(PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch, PhyloNeighbor *added_branch) {
+    int nstates = aln->getMaxNumStates();
+    const int NUM_BITS = VectorClass::size() * UINT_BITS;
+    size_t nsites = (aln->num_parsimony_sites+NUM_BITS-1)/NUM_BITS;
+    size_t entry_size = nstates * VectorClass::size();
+    UINT *xpars = dad_branch->partial_pars, *ypars = node_branch->partial_pars, *spars = added_branch->partial_pars;
+    size_t scoreid = entry_size*nsites;
+    UINT score = xpars[scoreid] + ypars[scoreid] + spars[scoreid];
+
+    for (size_t site = 0; site < nsites; site++) {
+        size_t offset = entry_size*site;
+        VectorClass *x = (VectorClass*)(xpars + offset);
+        VectorClass *y = (VectorClass*)(ypars + offset);
+        VectorClass *s = (VectorClass*)(spars + offset);
+        // join the two sides of the branch, then attach the subtree
+        VectorClass w = 0;
+        int i;
+        for (i = 0; i < nstates; i++)
+            w |= x[i] & y[i];
+        w = ~w;
+        VectorClass v = 0;
+        for (i = 0; i < nstates; i++)
+            v |= ((x[i] & y[i]) | (w & (x[i] | y[i]))) & s[i];
+        v = ~v;
+        score += fast_popcount(w) + fast_popcount(v);
+    }
+    return score;
+}
+
+/**
+    Sankoff cost of the subtree below a branch for each state at the upper end of the branch
+    @param node node of the branch leading to the subtree
+    @param partial_pars partial parsimony of the branch, not used if node is a leaf
+    @param ptn first of VectorClass::size() patterns
+    @param[out] cost nstates vectors of costs
+*/
+template<class VectorClass>
+inline void computeSankoffBranchCostSIMD(Node *node, UINT *partial_pars, Alignment *aln, UINT *tip_partial_pars,
+                                         UINT *cost_matrix, size_t ptn, int nstates, VectorClass *cost)
+{
+    if (node->isLeaf()) {
+        for (int i = 0; i < VectorClass::size(); i++) {
+            UINT *tip_ptr = &tip_partial_pars[aln->ordered_pattern[ptn+i][node->id]*nstates];
+            UINT *cost_ptr = (UINT*)cost + i;
+            for (int j = 0; j < nstates; j++, cost_ptr += VectorClass::size())
+                *cost_ptr = tip_ptr[j];
+        }
+        // reload the lanes stored through UINT pointers before they are read as vectors
+        for (int j = 0; j < nstates; j++)
+            cost[j] = VectorClass().load_a((UINT*)&cost[j]);
+        return;
+    }
+    VectorClass *pars_ptr = (VectorClass*)&partial_pars[ptn*nstates];
+    UINT *cost_matrix_ptr = cost_matrix;
+    for (int i = 0; i < nstates; i++, cost_matrix_ptr += nstates) {
+        VectorClass value = pars_ptr[0] + cost_matrix_ptr[0];
+        for (int j = 1; j < nstates; j++)
+            value = min(pars_ptr[j] + cost_matrix_ptr[j], value);
+        cost[i] = value;
+    }
+}
+
+template<class VectorClass>
+void PhyloTree::computePartialParsimonyJoinSankoffSIMD(PhyloNeighbor *left_branch, PhyloNeighbor *right_branch, UINT *partial_pars) {
+    int nstates = aln->num_states;
+    VectorClass *cost = aligned_alloc<VectorClass>(nstates*2);
+    VectorClass *cost_right = cost + nstates;
+
+    for (size_t ptn = 0; ptn < aln->ordered_pattern.size(); ptn+=VectorClass::size()) {
+        computeSankoffBranchCostSIMD(left_branch->node, left_branch->partial_pars, aln, tip_partial_pars, cost_matrix, ptn, nstates, cost);
+        computeSankoffBranchCostSIMD(right_branch->node, right_branch->partial_pars, aln, tip_partial_pars, cost_matrix, ptn, nstates, cost_right);
+        VectorClass *partial_pars_ptr = (VectorClass*)&partial_pars[ptn*nstates];
+        for (int i = 0; i < nstates; i++)
+            partial_pars_ptr[i] = cost[i] + cost_right[i];
+    }
+    aligned_free(cost);
+}
+
+template<class VectorClass>
+int PhyloTree::computeParsimonyInsertSankoffSIMD(PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch, PhyloNeighbor *added_branch) {
+    int nstates = aln->num_states;
+    VectorClass *cost = aligned_alloc<VectorClass>(nstates*3);
+    VectorClass *cost_node = cost + nstates;
+    VectorClass *cost_added = cost_node + nstates;
+    VectorClass tree_pars = 0;
+
+    // the new node joining the three subtrees serves as root
+    for (size_t ptn = 0; ptn < aln->ordered_pattern.size(); ptn+=VectorClass::size()) {
+        computeSankoffBranchCostSIMD(dad_branch->node, dad_branch->partial_pars, aln, tip_partial_pars, cost_matrix, ptn, nstates, cost);
+        computeSankoffBranchCostSIMD(node_branch->node, node_branch->partial_pars, aln, tip_partial_pars, cost_matrix, ptn, nstates, cost_node);
+        computeSankoffBranchCostSIMD(added_branch->node, added_branch->partial_pars, aln, tip_partial_pars, cost_matrix, ptn, nstates, cost_added);
+        VectorClass min_ptn_pars = cost[0] + cost_node[0] + cost_added[0];
+        for (int i = 1; i < nstates; i++)
+            min_ptn_pars = min(cost[i] + cost_node[i] + cost_added[i], min_ptn_pars);
+        tree_pars += min_ptn_pars * VectorClass().load_a(&ptn_freq_pars[ptn]);
+    }
+    aligned_free(cost);
+    return horizontal_add(tree_pars);
+}
+
 #endif /* PHYLOKERNEL_H_ */
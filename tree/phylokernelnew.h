@@ -313,6 +313,52 @@ inline void dotProductDualVec(Numeric *A, VectorClass *B, Numeric *C, VectorClas
     }
 }
 
+#ifndef KERNEL_FIX_STATES
+/** minimum number of states to switch the internal-internal partial likelihood kernel to pattern tiles */
+#define PARTIAL_LH_TILE_STATES 32
+/** number of pattern vectors in one tile */
+#define PARTIAL_LH_TILE 4
+#endif
+
+/**
+    Dual dotProduct of two matrix rows A, C with a tile of PARTIAL_LH_TILE pattern vectors B[t], D[t]:
+    X[t*stride] = (A.B[t]) * (C.D[t]), for all t = 0,...,PARTIAL_LH_TILE-1
+    Each element of A and C is loaded once for the whole tile, which keeps the
+    transition matrices of large state spaces from being streamed through the cache for every pattern vector.
+    template FMA = true to allow FMA instruction, false otherwise
+    @param N number of elements
+    @param A first matrix row of size N
+    @param B PARTIAL_LH_TILE vectors of size N
+    @param C second matrix row of size N
+    @param D PARTIAL_LH_TILE vectors of size N
+    @param[out] X results, X[t*stride] for pattern vector t
+    @param stride distance between consecutive results in X
+*/
+#ifdef KERNEL_FIX_STATES
+template <class VectorClass, class Numeric, const size_t N, const bool FMA>
+inline void dotProductDualVecTile(Numeric *A, VectorClass **B, Numeric *C, VectorClass **D, VectorClass *X, size_t stride)
+#else
+template <class VectorClass, class Numeric, const bool FMA>
+inline void dotProductDualVecTile(Numeric *A, VectorClass **B, Numeric *C, VectorClass **D, VectorClass *X, size_t stride, size_t N)
+#endif
+{
+    VectorClass AB[PARTIAL_LH_TILE], CD[PARTIAL_LH_TILE];
+    size_t i, t;
+    for (t = 0; t < PARTIAL_LH_TILE; t++) {
+        AB[t] = A[0] * B[t][0];
+        CD[t] = C[0] * D[t][0];
+    }
+    for (i = 1; i < N; i++) {
+        VectorClass a = A[i], c = C[i];
+        for (t = 0; t < PARTIAL_LH_TILE; t++) {
+            AB[t] = mul_add(a, B[t][i], AB[t]);
+            CD[t] = mul_add(c, D[t][i], CD[t]);
+        }
+    }
+    for (t = 0; t < PARTIAL_LH_TILE; t++)
+        X[t*stride] = AB[t] * CD[t];
+}
+
 /**
     compute product of a vector A and a matrix M, resulting in a vector X:
     X[i] = A[0]*M[i,0] + ... + A[N-1]*M[i,N-1], for all i = 0,...,N-1
@@ -1140,6 +1186,45 @@ inline void computeBounds(int threads, int packets, size_t elements, vector<size
             outError("Too many threads may slow down analysis [-nt option]. Reduce threads or use -nt AUTO to automatically determine it");
     }
 }
+
+/**
+    get partial likelihoods of a pattern vector for reading.
+    If they are stored in single precision, they are unpacked into double precision buffer.
+    @param partial_lh partial_lh vector of a branch
+    @param offset entry offset of the pattern vector
+    @param size number of entries of the pattern vector
+    @param buffer scratch buffer of size entries, only used for single precision
+    @param lh_float true if partial_lh is stored in single precision
+    @return pointer to double-precision partial likelihoods
+*/
+inline double *loadPartialLh(double *partial_lh, size_t offset, size_t size, double *buffer, bool lh_float) {
+    if (!lh_float)
+        return partial_lh + offset;
+    float *src = ((float*)partial_lh) + offset;
+    for (size_t i = 0; i < size; i++)
+        buffer[i] = src[i];
+    return buffer;
+}
+
+/**
+    get the location to compute partial likelihoods of a pattern vector,
+    which is the scratch buffer if they are stored in single precision
+    (followed by storePartialLh when done)
+*/
+inline double *writePartialLh(double *partial_lh, size_t offset, double *buffer, bool lh_float) {
+    return lh_float ? buffer : partial_lh + offset;
+}
+
+/**
+    pack partial likelihoods of a pattern vector computed by writePartialLh into single precision
+*/
+inline void storePartialLh(double *partial_lh, size_t offset, size_t size, double *buffer, bool lh_float) {
+    if (!lh_float)
+        return;
+    float *dst = ((float*)partial_lh) + offset;
+    for (size_t i = 0; i < size; i++)
+        dst[i] = (float)buffer[i];
+}
 #endif
 
 #ifdef KERNEL_FIX_STATES
@@ -1352,6 +1437,15 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
     // precomputed buffer to save times
     size_t thread_buf_size        = (2*block+nstates)*VectorClass::size();
     double *buffer_partial_lh_ptr = buffer_partial_lh + (getBufferPartialLhSize() - thread_buf_size*num_packets);
+    // scratch to unpack partial_lh stored in single precision
+    size_t vec_block = block*VectorClass::size();
+    double *float_lh_dad = NULL, *float_lh_left = NULL, *float_lh_right = NULL;
+    if (partial_lh_float) {
+        float_lh_dad = getBufferPartialLhFloat(block, VectorClass::size(), packet_id);
+        float_lh_left = float_lh_dad + vec_block;
+        float_lh_right = float_lh_left + vec_block;
+    }
+    const double scaling_threshold = partial_lh_float ? SCALING_THRESHOLD_FLOAT : SCALING_THRESHOLD;
     double *echildren = NULL;
     double *partial_lh_leaves = NULL;
 
@@ -1459,7 +1553,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                     } else {
                         // internal node
                         VectorClass *partial_lh = partial_lh_all;
-                        VectorClass *partial_lh_child = (VectorClass*)(child->partial_lh + ptn*block);
+                        VectorClass *partial_lh_child = (VectorClass*)loadPartialLh(child->partial_lh, ptn*block, vec_block, float_lh_left, partial_lh_float);
                         if (!SAFE_NUMERIC) {
                             for (size_t i = 0; i < VectorClass::size(); i++)
                                 dad_branch->scale_num[ptn+i] += child->scale_num[ptn+i];
@@ -1526,7 +1620,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                     } else {
                         // internal node
                         VectorClass *partial_lh = partial_lh_all;
-                        VectorClass *partial_lh_child = (VectorClass*)(child->partial_lh + ptn*block);
+                        VectorClass *partial_lh_child = (VectorClass*)loadPartialLh(child->partial_lh, ptn*block, vec_block, float_lh_left, partial_lh_float);
                         if (!SAFE_NUMERIC) {
                             for (size_t i = 0; i < VectorClass::size(); i++)
                                 dad_branch->scale_num[ptn+i] += child->scale_num[ptn+i];
@@ -1563,7 +1657,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                         for (size_t x = 0; x < nstates; x++)
                             lh_max = max(lh_max,abs(partial_lh_tmp[x]));
                         // check if one should scale partial likelihoods
-                        auto underflown = ((lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
+                        auto underflown = ((lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
                         if (horizontal_or(underflown)) { // at least one site has numerical underflown
                             for (size_t x = 0; x < VectorClass::size(); x++)
                             if (underflown[x]) {
@@ -1582,7 +1676,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                     VectorClass lh_max = 0.0;
                     for (size_t x = 0; x < block; x++)
                         lh_max = max(lh_max,abs(partial_lh_all[x]));
-                    auto underflown = (lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
+                    auto underflown = (lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
                     if (horizontal_or(underflown)) { // at least one site has numerical underflown
                         for (size_t x = 0; x < VectorClass::size(); x++) {
                             if (underflown[x]) {
@@ -1603,7 +1697,8 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
         
             // compute dot-product with inv_eigenvector
             VectorClass *partial_lh_tmp = partial_lh_all;
-            VectorClass *partial_lh = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+            double *dad_lh = writePartialLh(dad_branch->partial_lh, ptn*block, float_lh_dad, partial_lh_float);
+            VectorClass *partial_lh = (VectorClass*)dad_lh;
             VectorClass lh_max = 0.0;
             double *inv_evec_ptr = SITE_MODEL ? &inv_evec[ptn*states_square] : NULL;
             for (size_t c = 0; c < ncat_mix; c++) {
@@ -1625,6 +1720,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                 partial_lh += nstates;
                 partial_lh_tmp += nstates;
             }
+            storePartialLh(dad_branch->partial_lh, ptn*block, vec_block, dad_lh, partial_lh_float);
 
         } // for ptn
 
@@ -1648,7 +1744,8 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
         auto unknown = aln->STATE_UNKNOWN;
 
         for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
-            VectorClass *partial_lh = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+            double *dad_lh = writePartialLh(dad_branch->partial_lh, ptn*block, float_lh_dad, partial_lh_float);
+            VectorClass *partial_lh = (VectorClass*)dad_lh;
 
             if (SITE_MODEL) {
                 VectorClass* expleft = (VectorClass*) vec_left;
@@ -1742,6 +1839,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                     partial_lh += nstates;
                 } // FOR category
             } // IF SITE_MODEL
+            storePartialLh(dad_branch->partial_lh, ptn*block, vec_block, dad_lh, partial_lh_float);
 		} // FOR LOOP
 
 
@@ -1765,8 +1863,9 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
         auto unknown = aln->STATE_UNKNOWN;
         
         for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
-            VectorClass *partial_lh = (VectorClass*)(dad_branch->partial_lh + ptn*block);
-            VectorClass *partial_lh_right = (VectorClass*)(right->partial_lh + ptn*block);
+            double *dad_lh = writePartialLh(dad_branch->partial_lh, ptn*block, float_lh_dad, partial_lh_float);
+            VectorClass *partial_lh = (VectorClass*)dad_lh;
+            VectorClass *partial_lh_right = (VectorClass*)loadPartialLh(right->partial_lh, ptn*block, vec_block, float_lh_right, partial_lh_float);
             VectorClass lh_max = 0.0;
 
             if (SITE_MODEL) {
@@ -1798,13 +1897,13 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
 #endif
                     // check if one should scale partial likelihoods
                     if (SAFE_NUMERIC) {
-                        auto underflown = ((lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
+                        auto underflown = ((lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
                         if (horizontal_or(underflown)) { // at least one site has numerical underflown
                             for (size_t x = 0; x < VectorClass::size(); x++)
                             if (underflown[x]) {
                                 // BQM 2016-05-03: only scale for non-constant sites
                                 // now do the likelihood scaling
-                                double *partial_lh = dad_branch->partial_lh + (ptn*block + c*nstates*VectorClass::size() + x);
+                                double *partial_lh = dad_lh + (c*nstates*VectorClass::size() + x);
                                 for (size_t i = 0; i < nstates; i++)
                                     partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], SCALING_THRESHOLD_EXP);
                                 dad_branch->scale_num[(ptn+x)*ncat_mix+c] += 1;
@@ -1866,13 +1965,13 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
     #endif
                     // check if one should scale partial likelihoods
                     if (SAFE_NUMERIC) {
-                        auto underflown = ((lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
+                        auto underflown = ((lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
                         if (horizontal_or(underflown)) { // at least one site has numerical underflown
                             for (size_t x = 0; x < VectorClass::size(); x++) {
                                 if (underflown[x]) {
                                     // BQM 2016-05-03: only scale for non-constant sites
                                     // now do the likelihood scaling
-                                    double *partial_lh = dad_branch->partial_lh + (ptn*block + c*nstates*VectorClass::size() + x);
+                                    double *partial_lh = dad_lh + (c*nstates*VectorClass::size() + x);
                                     for (size_t i = 0; i < nstates; i++)
                                         partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], SCALING_THRESHOLD_EXP);
                                     dad_branch->scale_num[(ptn+x)*ncat_mix+c] += 1;
@@ -1887,11 +1986,11 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
             } // IF SITE_MODEL
 
             if (!SAFE_NUMERIC) {
-                auto underflown = (lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
+                auto underflown = (lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
                 if (horizontal_or(underflown)) { // at least one site has numerical underflown
                     for (size_t x = 0; x < VectorClass::size(); x++)
                     if (underflown[x]) {
-                        double *partial_lh = dad_branch->partial_lh + (ptn*block + x);
+                        double *partial_lh = dad_lh + x;
                         // now do the likelihood scaling
                         for (size_t i = 0; i < block; i++) {
                             partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], SCALING_THRESHOLD_EXP);
@@ -1901,9 +2000,125 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                     }
                 }
             }
+            storePartialLh(dad_branch->partial_lh, ptn*block, vec_block, dad_lh, partial_lh_float);
 
 		} // big for loop over ptn
 
+	} else if (!SITE_MODEL && nstates >= PARTIAL_LH_TILE_STATES && ncat_mix >= 2 && !partial_lh_float) {
+
+        /*--------------------- INTERNAL-INTERNAL NODE case, tiled over patterns ------------------*/
+
+        // for large state spaces echildren does not fit into cache any more, thus each row of echildren
+        // is applied to PARTIAL_LH_TILE pattern vectors at once. The thread buffer holds at least
+        // 2*ncat_mix+1 >= PARTIAL_LH_TILE vectors of nstates for the temporary results of one category
+        VectorClass *partial_lh_tmp
+            = (VectorClass*)(buffer_partial_lh_ptr + thread_buf_size * packet_id);
+        const size_t VCSIZE = VectorClass::size();
+		for (size_t ptn_tile = ptn_lower; ptn_tile < ptn_upper; ptn_tile += PARTIAL_LH_TILE*VCSIZE) {
+            // the last tile may be incomplete: pad it with the last pattern vector and ignore the results
+            size_t ntile = min((size_t)PARTIAL_LH_TILE, (ptn_upper - ptn_tile)/VCSIZE);
+            VectorClass *partial_lh[PARTIAL_LH_TILE], *partial_lh_left[PARTIAL_LH_TILE], *partial_lh_right[PARTIAL_LH_TILE];
+            VectorClass lh_max[PARTIAL_LH_TILE];
+            UBYTE *scale_dad[PARTIAL_LH_TILE], *scale_left[PARTIAL_LH_TILE], *scale_right[PARTIAL_LH_TILE];
+            size_t t;
+            for (t = 0; t < PARTIAL_LH_TILE; t++) {
+                size_t ptn = ptn_tile + min(t, ntile-1)*VCSIZE;
+                partial_lh[t] = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+                partial_lh_left[t] = (VectorClass*)(left->partial_lh + ptn*block);
+                partial_lh_right[t] = (VectorClass*)(right->partial_lh + ptn*block);
+                lh_max[t] = 0.0;
+                if (SAFE_NUMERIC) {
+                    size_t addr = ptn*ncat_mix;
+                    scale_dad[t]   = dad_branch->scale_num + addr;
+                    scale_left[t]  = left->scale_num + addr;
+                    scale_right[t] = right->scale_num + addr;
+                } else {
+                    scale_dad[t]   = dad_branch->scale_num + ptn;
+                    scale_left[t]  = left->scale_num + ptn;
+                    scale_right[t] = right->scale_num + ptn;
+                    if (t < ntile)
+                        for (size_t i = 0; i < VCSIZE; i++) {
+                            scale_dad[t][i] = scale_left[t][i] + scale_right[t][i];
+                        }
+                }
+            }
+
+            double *eleft_ptr = eleft;
+            double *eright_ptr = eright;
+
+			for (size_t c = 0; c < ncat_mix; c++) {
+                if (SAFE_NUMERIC) {
+                    for (t = 0; t < ntile; t++) {
+                        lh_max[t] = 0.0;
+                        for (size_t x = 0; x < VCSIZE; x++)
+                            scale_dad[t][x*ncat_mix] = scale_left[t][x*ncat_mix] + scale_right[t][x*ncat_mix];
+                    }
+                }
+
+                double *inv_evec_ptr = inv_evec + mix_addr[c];
+                // compute real partial likelihood vectors of the whole tile
+                for (size_t x = 0; x < nstates; x++) {
+#ifdef KERNEL_FIX_STATES
+                    dotProductDualVecTile<VectorClass, double, nstates, FMA>(eleft_ptr, partial_lh_left, eright_ptr, partial_lh_right, partial_lh_tmp+x, nstates);
+#else
+                    dotProductDualVecTile<VectorClass, double, FMA>(eleft_ptr, partial_lh_left, eright_ptr, partial_lh_right, partial_lh_tmp+x, nstates, nstates);
+#endif
+                    eleft_ptr += nstates;
+                    eright_ptr += nstates;
+                }
+
+                for (t = 0; t < ntile; t++) {
+                    // compute dot-product with inv_eigenvector
+#ifdef KERNEL_FIX_STATES
+                    productVecMat<VectorClass, double, nstates, FMA>(partial_lh_tmp + t*nstates, inv_evec_ptr, partial_lh[t], lh_max[t]);
+#else
+                    productVecMat<VectorClass, double, FMA> (partial_lh_tmp + t*nstates, inv_evec_ptr, partial_lh[t], lh_max[t], nstates);
+#endif
+                    // check if one should scale partial likelihoods
+                    if (SAFE_NUMERIC) {
+                        size_t ptn = ptn_tile + t*VCSIZE;
+                        auto underflown = ((lh_max[t] < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
+                        if (horizontal_or(underflown))
+                            for (size_t x = 0; x < VCSIZE; x++)
+                            if (underflown[x]) {
+                                // BQM 2016-05-03: only scale for non-constant sites
+                                // now do the likelihood scaling
+                                double *partial_lh_ptr = (double*)partial_lh[t] + x;
+                                for (size_t i = 0; i < nstates; i++)
+                                    partial_lh_ptr[i*VCSIZE] = ldexp(partial_lh_ptr[i*VCSIZE], SCALING_THRESHOLD_EXP);
+                                scale_dad[t][x*ncat_mix] += 1;
+                            }
+                        scale_dad[t]++;
+                        scale_left[t]++;
+                        scale_right[t]++;
+                    }
+                }
+                for (t = 0; t < PARTIAL_LH_TILE; t++) {
+                    partial_lh_left[t] += nstates;
+                    partial_lh_right[t] += nstates;
+                    partial_lh[t] += nstates;
+                }
+			}
+
+            if (!SAFE_NUMERIC) {
+                for (t = 0; t < ntile; t++) {
+                    // check if one should scale partial likelihoods
+                    size_t ptn = ptn_tile + t*VCSIZE;
+                    auto underflown = (lh_max[t] < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
+                    if (horizontal_or(underflown)) { // at least one site has numerical underflown
+                        for (size_t x = 0; x < VCSIZE; x++)
+                        if (underflown[x]) {
+                            double *partial_lh_ptr = dad_branch->partial_lh + ptn*block + x;
+                            // now do the likelihood scaling
+                            for (size_t i = 0; i < block; i++) {
+                                partial_lh_ptr[i*VCSIZE] = ldexp(partial_lh_ptr[i*VCSIZE], SCALING_THRESHOLD_EXP);
+                            }
+                            dad_branch->scale_num[ptn+x] += 1;
+                        }
+                    }
+                }
+            }
+        } // big for loop over ptn
 	} else {
 
         /*--------------------- INTERNAL-INTERNAL NODE case ------------------*/
@@ -1911,9 +2126,10 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
         VectorClass *partial_lh_tmp
             = (VectorClass*)(buffer_partial_lh_ptr + thread_buf_size * packet_id);
 		for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
-			VectorClass *partial_lh = (VectorClass*)(dad_branch->partial_lh + ptn*block);
-			VectorClass *partial_lh_left = (VectorClass*)(left->partial_lh + ptn*block);
-			VectorClass *partial_lh_right = (VectorClass*)(right->partial_lh + ptn*block);
+			double *dad_lh = writePartialLh(dad_branch->partial_lh, ptn*block, float_lh_dad, partial_lh_float);
+			VectorClass *partial_lh = (VectorClass*)dad_lh;
+			VectorClass *partial_lh_left = (VectorClass*)loadPartialLh(left->partial_lh, ptn*block, vec_block, float_lh_left, partial_lh_float);
+			VectorClass *partial_lh_right = (VectorClass*)loadPartialLh(right->partial_lh, ptn*block, vec_block, float_lh_right, partial_lh_float);
             VectorClass lh_max = 0.0;
             UBYTE *scale_dad, *scale_left, *scale_right;
 
@@ -1992,13 +2208,13 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
 
                 // check if one should scale partial likelihoods
                 if (SAFE_NUMERIC) {
-                    auto underflown = ((lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
+                    auto underflown = ((lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
                     if (horizontal_or(underflown))
                         for (size_t x = 0; x < VectorClass::size(); x++)
                         if (underflown[x]) {
                             // BQM 2016-05-03: only scale for non-constant sites
                             // now do the likelihood scaling
-                            double *partial_lh = dad_branch->partial_lh + (ptn*block + c*nstates*VectorClass::size() + x);
+                            double *partial_lh = dad_lh + (c*nstates*VectorClass::size() + x);
                             for (size_t i = 0; i < nstates; i++)
                                 partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], SCALING_THRESHOLD_EXP);
                             scale_dad[x*ncat_mix] += 1;
@@ -2014,11 +2230,11 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
 
             if (!SAFE_NUMERIC) {
                 // check if one should scale partial likelihoods
-                auto underflown = (lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
+                auto underflown = (lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
                 if (horizontal_or(underflown)) { // at least one site has numerical underflown
                     for (size_t x = 0; x < VectorClass::size(); x++)
                     if (underflown[x]) {
-                        double *partial_lh = dad_branch->partial_lh + (ptn*block + x);
+                        double *partial_lh = dad_lh + x;
                         // now do the likelihood scaling
                         for (size_t i = 0; i < block; i++) {
                             partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], SCALING_THRESHOLD_EXP);
@@ -2028,6 +2244,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                     }
                 }
             }
+            storePartialLh(dad_branch->partial_lh, ptn*block, vec_block, dad_lh, partial_lh_float);
         } // big for loop over ptn
     }
 
@@ -2088,6 +2305,14 @@ void PhyloTree::computeLikelihoodBufferGenericSIMD(PhyloNeighbor *dad_branch, Ph
         computePartialLikelihood(*it, ptn_lower, ptn_upper, packet_id);
     }
 
+    // scratch to unpack partial_lh stored in single precision
+    size_t vec_block = block*VectorClass::size();
+    double *float_lh_dad = NULL, *float_lh_node = NULL;
+    if (partial_lh_float) {
+        float_lh_dad = getBufferPartialLhFloat(block, VectorClass::size(), packet_id);
+        float_lh_node = float_lh_dad + vec_block;
+    }
+
     if (dad->isLeaf()) {
         // special treatment for TIP-INTERNAL NODE case
         double *tip_partial_lh_node = &tip_partial_lh[dad->id * max_orig_nptn * nstates];
@@ -2098,7 +2323,7 @@ void PhyloTree::computeLikelihoodBufferGenericSIMD(PhyloNeighbor *dad_branch, Ph
         size_t offset     = ptn_lower*block;
         size_t offsetStep = block*VectorClass::size();
         for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size(), offset+=offsetStep) {
-            VectorClass *partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + offset);
+            VectorClass *partial_lh_dad = (VectorClass*)loadPartialLh(dad_branch->partial_lh, offset, vec_block, float_lh_dad, partial_lh_float);
             VectorClass *theta = (VectorClass*)(theta_all + offset);
             //load tip vector
             if (!SITE_MODEL) {
@@ -2182,8 +2407,8 @@ void PhyloTree::computeLikelihoodBufferGenericSIMD(PhyloNeighbor *dad_branch, Ph
         // now compute theta
         for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
             VectorClass *theta = (VectorClass*)(theta_all + ptn*block);
-            VectorClass *partial_lh_node = (VectorClass*)(node_branch->partial_lh + ptn*block);
-            VectorClass *partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+            VectorClass *partial_lh_node = (VectorClass*)loadPartialLh(node_branch->partial_lh, ptn*block, vec_block, float_lh_node, partial_lh_float);
+            VectorClass *partial_lh_dad = (VectorClass*)loadPartialLh(dad_branch->partial_lh, ptn*block, vec_block, float_lh_dad, partial_lh_float);
             for (size_t i = 0; i < block; i++) {
                 theta[i] = partial_lh_node[i] * partial_lh_dad[i];
             }
@@ -2823,11 +3048,13 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
                 computePartialLikelihood(*it, ptn_lower, ptn_upper, packet_id);
             }
             double *vec_tip = buffer_partial_lh_ptr + block*VectorClass::size() * packet_id;
+            // scratch to unpack partial_lh stored in single precision
+            double *float_lh_dad = partial_lh_float ? getBufferPartialLhFloat(block, VectorClass::size(), packet_id) : NULL;
 
             for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
                 VectorClass lh_ptn(0.0);
                 VectorClass *lh_cat = (VectorClass*)(_pattern_lh_cat + ptn*ncat_mix);
-                VectorClass *partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+                VectorClass *partial_lh_dad = (VectorClass*)loadPartialLh(dad_branch->partial_lh, ptn*block, block*VectorClass::size(), float_lh_dad, partial_lh_float);
                 VectorClass *lh_node = SITE_MODEL ? (VectorClass*)&partial_lh_node[ptn*nstates] : (VectorClass*)vec_tip;
 
                 if (SITE_MODEL) {
@@ -2981,13 +3208,20 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
                 computePartialLikelihood(*it, ptn_lower, ptn_upper, packet_id);
             }
 
+            // scratch to unpack partial_lh stored in single precision
+            double *float_lh_dad = NULL, *float_lh_node = NULL;
+            if (partial_lh_float) {
+                float_lh_dad = getBufferPartialLhFloat(block, VectorClass::size(), packet_id);
+                float_lh_node = float_lh_dad + block*VectorClass::size();
+            }
+
             VectorClass vc_tree_lh(0.0);
             VectorClass vc_prob_const(0.0);
             for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
                 VectorClass lh_ptn(0.0);
                 VectorClass *lh_cat = (VectorClass*)(_pattern_lh_cat + ptn*ncat_mix);
-                VectorClass *partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + ptn*block);
-                VectorClass *partial_lh_node = (VectorClass*)(node_branch->partial_lh + ptn*block);
+                VectorClass *partial_lh_dad = (VectorClass*)loadPartialLh(dad_branch->partial_lh, ptn*block, block*VectorClass::size(), float_lh_dad, partial_lh_float);
+                VectorClass *partial_lh_node = (VectorClass*)loadPartialLh(node_branch->partial_lh, ptn*block, block*VectorClass::size(), float_lh_node, partial_lh_float);
 
                 // compute likelihood per category
                 if (SITE_MODEL) {
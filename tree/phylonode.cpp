@@ -32,6 +32,18 @@ void PhyloNode::clearReversePartialLh(PhyloNode *dad) {
 		}
 }
 
+void PhyloNode::clearReversePartialPars(PhyloNode *dad) {
+    for (NeighborVec::iterator it = neighbors.begin(); it != neighbors.end(); it ++)
+        if ((*it)->node != dad) {
+            PhyloNeighbor *nei = (PhyloNeighbor*)(*it)->node->findNeighbor(this);
+            if (nei->partial_lh_computed == 0)
+                continue;
+            nei->partial_lh_computed = 0;
+            nei->size = 0;
+            ((PhyloNode*)(*it)->node)->clearReversePartialPars(this);
+        }
+}
+
 void PhyloNode::clearAllPartialLh(bool make_null, PhyloNode* dad) {
 	PhyloNeighbor* node_nei = (PhyloNeighbor*)findNeighbor(dad);
 	node_nei->partial_lh_computed = 0;
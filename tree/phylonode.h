@@ -243,6 +243,11 @@ public:
      */
     void clearReversePartialLh(PhyloNode *dad);
 
+    /**
+        like clearReversePartialLh() but stops at vectors not computed, as nothing depending on them is computed
+     */
+    void clearReversePartialPars(PhyloNode *dad);
+
     void computeReversePartialLh(PhyloNode *dad);
 
     /** 
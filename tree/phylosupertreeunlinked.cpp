@@ -293,8 +293,9 @@ void PhyloSuperTreeUnlinked::writeUFBootTrees(Params &params) {
     
     for (auto tree = begin(); tree != end(); tree++) {
         MTreeSet trees;
+        IntVector sample_trees;
 
-        trees.init(((IQTree*)*tree)->boot_trees, (*tree)->rooted);
+        trees.init(((IQTree*)*tree)->boot_trees, (*tree)->rooted, &sample_trees);
         for (i = 0; i < trees.size(); i++) {
             NodeVector taxa;
             // change the taxa name from ID to real name
@@ -305,13 +306,15 @@ void PhyloSuperTreeUnlinked::writeUFBootTrees(Params &params) {
                 // reinsert removed seqs into each tree
                 trees[i]->insertTaxa(removed_seqs, twin_seqs);
             }
-            // now print to file
-            for (j = 0; j < trees.tree_weights[i]; j++)
+        }
+        // now print to file in the order of bootstrap samples
+        for (auto it = sample_trees.begin(); it != sample_trees.end(); it++)
+            if (*it >= 0) {
                 if (params.print_ufboot_trees == 1)
-                    trees[i]->printTree(out, WT_NEWLINE);
+                    trees[*it]->printTree(out, WT_NEWLINE);
                 else
-                    trees[i]->printTree(out, WT_NEWLINE + WT_BR_LEN);
-        }
+                    trees[*it]->printTree(out, WT_NEWLINE + WT_BR_LEN);
+            }
     }
     cout << "UFBoot trees printed to " << filename << endl;
     out.close();
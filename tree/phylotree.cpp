@@ -135,6 +135,7 @@ void PhyloTree::init() {
     num_partial_lh_computations = 0;
     vector_size = 0;
     safe_numeric = false;
+    partial_lh_float = false;
     summary = nullptr;
     isSummaryBorrowed = false;
     progress = nullptr;
@@ -230,6 +231,7 @@ void myPartitionsDestroy(partitionList *pl) {
 
 PhyloTree::~PhyloTree() {
     doneComputingDistances();
+    deleteGradientClones();
     aligned_free(nni_scale_num);
     aligned_free(nni_partial_lh);
     aligned_free(central_partial_lh);
@@ -817,7 +819,8 @@ size_t PhyloTree::getBitsBlockSize() {
     // reserve the last entry for parsimony score
 //    return (aln->num_states * aln->size() + UINT_BITS - 1) / UINT_BITS + 1;
     if (cost_matrix) {
-        return get_safe_upper_limit_float(aln->size() * aln->num_states);
+        // patterns are padded to whole vectors, each taking num_states entries
+        return get_safe_upper_limit_float(aln->size()) * aln->num_states;
     }
     size_t len = aln->getMaxNumStates() * ((max(aln->size(), (size_t)aln->num_variant_sites) + SIMD_BITS - 1) / UINT_BITS) + 4;
 #ifdef __AVX512KNL
@@ -887,9 +890,20 @@ size_t PhyloTree::getBufferPartialLhSize() {
         size_t nmix = max(getMixlen(), getRate()->getNRate());
         buffer_size += nmix*(nmix+1)*VECTOR_SIZE + (nmix+3)*nmix*VECTOR_SIZE*num_packets;
     }
+
+    // scratch to unpack single-precision partial_lh of dad and two children
+    if (partial_lh_float)
+        buffer_size += 3*block*VECTOR_SIZE*num_packets;
     return buffer_size;
 }
 
+double *PhyloTree::getBufferPartialLhFloat(size_t block, size_t vsize, int packet_id) {
+    // located right before the thread buffer of computePartialLikelihood
+    size_t thread_buf_size = (2*block+model->num_states)*vsize;
+    return buffer_partial_lh + getBufferPartialLhSize() - thread_buf_size*num_packets
+        - 3*block*vsize*(num_packets-packet_id);
+}
+
 void PhyloTree::initializeAllPartialLh() {
     int index, indexlh;
     int numStates = model->num_states;
@@ -988,13 +1002,13 @@ uint64_t PhyloTree::getMemoryRequired(size_t ncategory, bool full_mem) {
 
     // memory for UFBoot
     if (params->gbo_replicates)
-        mem_size += params->gbo_replicates*nptn*sizeof(BootValType);
+        mem_size += params->gbo_replicates*nptn*(params->ufboot_compact ? params->ufboot_compact/8 : sizeof(BootValType));
 
     // memory for model
     if (model)
         mem_size += model->getMemoryRequired();
 
-    int64_t lh_scale_size = block_size * sizeof(double) + scale_block_size * sizeof(UBYTE);
+    int64_t lh_scale_size = block_size * (partial_lh_float ? sizeof(float) : sizeof(double)) + scale_block_size * sizeof(UBYTE);
 
     max_lh_slots = leafNum-2;
 
@@ -1064,6 +1078,9 @@ void PhyloTree::initializeAllPartialLh(int &index, int &indexlh, PhyloNode *node
     uint64_t block_size;
     uint64_t scale_block_size = nptn * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
     block_size = scale_block_size * model->num_states;
+    // two float entries per double
+    if (partial_lh_float)
+        block_size /= 2;
 
     if (!node) {
         node = (PhyloNode*) root;
@@ -1196,6 +1213,9 @@ size_t PhyloTree::getPartialLhSize() {
     size_t block_size = get_safe_upper_limit(aln->size())+max(get_safe_upper_limit(aln->num_states),
         get_safe_upper_limit(model_factory->unobserved_ptns.size()));
     block_size *= model->num_states * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
+    // two float entries per double
+    if (partial_lh_float)
+        block_size /= 2;
     return block_size;
 }
 
@@ -2448,6 +2468,272 @@ double PhyloTree::computeLikelihoodZeroBranch(PhyloNeighbor *dad_branch, PhyloNo
 }
 
 
+/****************************************************************************
+ Analytic derivatives of the log-likelihood w.r.t. the rate matrix, the state
+ frequencies and the rate heterogeneity, computed from the partial likelihoods
+ of all branches in a single pass
+ ****************************************************************************/
+
+bool PhyloTree::isLikelihoodGradientSupported() {
+    if (!params || !params->analytic_gradient)
+        return false;
+    if (isSuperTree() || isMixlen() || !model_factory || !model || !site_rate)
+        return false;
+    if (!model->useRevKernel() || model->isMixture() || model->isSiteSpecificModel() || model->isPolymorphismAware())
+        return false;
+    if (!model_factory->unobserved_ptns.empty() || params->robust_phy_keep < 1.0 || params->robust_median)
+        return false;
+    return leafNum >= 3;
+}
+
+/**
+    @return element (cat, state) of a partial likelihood vector at a pattern,
+    where vectors of vector_size patterns are interleaved
+*/
+inline double getPartialLhEntry(double *partial_lh, bool is_float, size_t ptn, size_t block, size_t vsize, size_t entry) {
+    size_t v = ptn % vsize;
+    size_t index = (ptn - v)*block + entry*vsize + v;
+    return is_float ? ((float*)partial_lh)[index] : partial_lh[index];
+}
+
+bool PhyloTree::computeLikelihoodGradient(LikelihoodGradient &grad) {
+    if (!isLikelihoodGradientSupported())
+        return false;
+
+    size_t nstates = aln->num_states;
+    size_t nsqr = nstates*nstates;
+    size_t ncat = site_rate->getNRate();
+    size_t block = ncat*nstates;
+    size_t orig_nptn = aln->size();
+    size_t vsize = vector_size;
+    double *eval = model->getEigenvalues();
+    double *evec = model->getEigenvectors();
+    double p_invar = site_rate->getPInvar();
+    DoubleVector cat_rate(ncat), cat_prop(ncat);
+    for (size_t c = 0; c < ncat; c++) {
+        cat_rate[c] = site_rate->getRate(c);
+        cat_prop[c] = site_rate->getProp(c);
+    }
+
+    grad.eigen_grad.assign(nsqr, 0.0);
+    grad.freq_grad.assign(nstates, 0.0);
+    grad.rate_grad.assign(ncat, 0.0);
+    grad.prop_grad.assign(ncat, 0.0);
+    grad.invar_grad = 0.0;
+
+    // branches directed away from the root
+    BranchVector branches;
+    getBranches(branches);
+    // sum over patterns of w_ptn/L_ptn * p_c * A_ci * B_cj per category of the current branch
+    DoubleVector sum_ab(ncat*nsqr);
+    DoubleVector exp_eval(block);
+
+    for (size_t b = 0; b < branches.size(); b++) {
+        PhyloNode *dad = (PhyloNode*)branches[b].first;
+        PhyloNode *node = (PhyloNode*)branches[b].second;
+        if (node->isLeaf())
+            swap(dad, node);
+        PhyloNeighbor *dad_branch = (PhyloNeighbor*)dad->findNeighbor(node);
+        PhyloNeighbor *node_branch = (PhyloNeighbor*)node->findNeighbor(dad);
+        // make sure that the partial likelihoods of both sides are computed
+        computeLikelihoodBranch(dad_branch, dad);
+        // lh_a is the subtree of node, lh_b that of dad. The derivatives must be taken
+        // with all branches directed away from the root at the first branch, as
+        // perturbing the frequencies breaks the symmetry of Pi*dP
+        bool a_is_parent = (node == branches[b].first);
+
+        double len = dad_branch->length;
+        for (size_t c = 0; c < ncat; c++)
+            for (size_t i = 0; i < nstates; i++)
+                exp_eval[c*nstates+i] = exp(eval[i]*len*cat_rate[c]);
+        bool first_branch = (b == 0);
+        bool dad_tip = dad->isLeaf();
+        const char *state_row = dad_tip ? getConvertedSequenceByNumber(dad->id) : NULL;
+        double invar_sum = 0.0;
+        sum_ab.assign(ncat*nsqr, 0.0);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads)
+#endif
+        {
+            DoubleVector my_sum(ncat*nsqr, 0.0), my_freq(nstates, 0.0);
+            DoubleVector lh_a(block), lh_b(block), lh_cat(ncat), scale(ncat);
+            double my_invar = 0.0;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+            for (size_t ptn = 0; ptn < orig_nptn; ptn++) {
+                if (ptn_freq[ptn] == 0.0)
+                    continue;
+                for (size_t k = 0; k < block; k++)
+                    lh_a[k] = getPartialLhEntry(dad_branch->partial_lh, partial_lh_float, ptn, block, vsize, k);
+                if (dad_tip) {
+                    int state = state_row ? state_row[ptn] : (aln->at(ptn))[dad->id];
+                    double *lh_tip = tip_partial_lh + state*nstates;
+                    for (size_t c = 0; c < ncat; c++)
+                        memcpy(&lh_b[c*nstates], lh_tip, nstates*sizeof(double));
+                } else {
+                    for (size_t k = 0; k < block; k++)
+                        lh_b[k] = getPartialLhEntry(node_branch->partial_lh, partial_lh_float, ptn, block, vsize, k);
+                }
+                // scaling of each category relative to the pattern likelihood, as in the branch kernel
+                if (safe_numeric) {
+                    int min_scale = INT_MAX;
+                    for (size_t c = 0; c < ncat; c++) {
+                        int s = dad_branch->scale_num[ptn*ncat+c];
+                        if (!dad_tip)
+                            s += node_branch->scale_num[ptn*ncat+c];
+                        scale[c] = s;
+                        min_scale = min(min_scale, s);
+                    }
+                    for (size_t c = 0; c < ncat; c++)
+                        scale[c] = (scale[c] == min_scale) ? 1.0 : (scale[c] == min_scale+1) ? SCALING_THRESHOLD : 0.0;
+                } else {
+                    for (size_t c = 0; c < ncat; c++)
+                        scale[c] = 1.0;
+                }
+                double lh_ptn = 0.0;
+                for (size_t c = 0; c < ncat; c++) {
+                    double lh = 0.0;
+                    for (size_t i = 0; i < nstates; i++)
+                        lh += exp_eval[c*nstates+i] * lh_a[c*nstates+i] * lh_b[c*nstates+i];
+                    lh_cat[c] = lh * cat_prop[c] * scale[c];
+                    lh_ptn += lh_cat[c];
+                }
+                lh_ptn = fabs(lh_ptn) + ptn_invar[ptn];
+                double weight = ptn_freq[ptn] / lh_ptn;
+                if (first_branch)
+                    my_invar += weight * ptn_invar[ptn];
+                for (size_t c = 0; c < ncat; c++) {
+                    double weight_cat = weight * cat_prop[c] * scale[c];
+                    if (weight_cat == 0.0)
+                        continue;
+                    double *a = a_is_parent ? &lh_a[c*nstates] : &lh_b[c*nstates];
+                    double *bb = a_is_parent ? &lh_b[c*nstates] : &lh_a[c*nstates];
+                    double *this_sum = &my_sum[c*nsqr];
+                    for (size_t i = 0; i < nstates; i++) {
+                        double wa = weight_cat * a[i];
+                        for (size_t j = 0; j < nstates; j++)
+                            this_sum[i*nstates+j] += wa * bb[j];
+                    }
+                    if (!first_branch)
+                        continue;
+                    // root frequency term: a_x (P b)_x in the original state space
+                    for (size_t x = 0; x < nstates; x++) {
+                        double ax = 0.0, pbx = 0.0;
+                        for (size_t i = 0; i < nstates; i++) {
+                            ax += evec[x*nstates+i] * a[i];
+                            pbx += evec[x*nstates+i] * exp_eval[c*nstates+i] * bb[i];
+                        }
+                        my_freq[x] += weight_cat * ax * pbx;
+                    }
+                }
+            }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+            {
+                for (size_t k = 0; k < ncat*nsqr; k++)
+                    sum_ab[k] += my_sum[k];
+                for (size_t x = 0; x < nstates; x++)
+                    grad.freq_grad[x] += my_freq[x];
+                invar_sum += my_invar;
+            }
+        }
+
+        // chain rule over P(t) = U exp(Lambda*t*r_c) U^-1
+        for (size_t c = 0; c < ncat; c++) {
+            double s = len*cat_rate[c];
+            double *ex = &exp_eval[c*nstates];
+            double *this_sum = &sum_ab[c*nsqr];
+            for (size_t i = 0; i < nstates; i++) {
+                grad.rate_grad[c] += len * eval[i] * ex[i] * this_sum[i*nstates+i];
+                if (first_branch && cat_prop[c] > 0.0)
+                    grad.prop_grad[c] += ex[i] * this_sum[i*nstates+i] / cat_prop[c];
+                for (size_t j = 0; j < nstates; j++) {
+                    double diff = eval[i] - eval[j];
+                    double phi;
+                    if (fabs(diff) < 1e-8)
+                        phi = s * exp(0.5*(eval[i]+eval[j])*s);
+                    else
+                        phi = (ex[i] - ex[j]) / diff;
+                    grad.eigen_grad[i*nstates+j] += phi * this_sum[i*nstates+j];
+                }
+            }
+        }
+        if (first_branch && p_invar > 0.0)
+            grad.invar_grad = invar_sum / p_invar;
+    }
+    return true;
+}
+
+/****************************************************************************
+ Copies of the tree evaluating the likelihood concurrently (--thread-grad)
+ ****************************************************************************/
+
+int PhyloTree::prepareGradientClones() {
+    if (!params || !params->openmp_by_grad || num_threads <= 1 || !model_factory)
+        return 0;
+    if (isSuperTree() || isMixlen() || isTreeMix() || params->pll)
+        return 0;
+    // e.g. temporary trees in the EM of mixture models, which may also carry
+    // modified pattern frequencies not copied here
+    if (model_factory->model_spec.empty())
+        return 0;
+#ifdef _OPENMP
+    if (omp_in_parallel())
+        return 0;
+#endif
+    string model_name = model_factory->model_spec;
+    if (!gradient_clones.empty() && gradient_clones[0]->getModelFactory()->model_spec != model_name)
+        deleteGradientClones();
+    string tree_str = getTreeString();
+    if (gradient_clones.empty()) {
+        ModelsBlock *models_block = readModelsDefinition(*params);
+        for (int id = 1; id < num_threads; id++) {
+            PhyloTree *clone = new PhyloTree(aln);
+            clone->setParams(params);
+            clone->setLikelihoodKernel(sse);
+            clone->setNumThreads(1);
+            clone->optimize_by_newton = optimize_by_newton;
+            clone->rooted = rooted;
+            clone->readTreeString(tree_str);
+            try {
+                string clone_model_name = model_name;
+                clone->setModelFactory(new ModelFactory(*params, clone_model_name, clone, models_block));
+            } catch (string &str) {
+                outError(str);
+            }
+            clone->setModel(clone->getModelFactory()->model);
+            clone->setRate(clone->getModelFactory()->site_rate);
+            gradient_clones.push_back(clone);
+        }
+        delete models_block;
+    }
+
+    // copy the model parameters via a temporary checkpoint
+    Checkpoint model_ckp;
+    Checkpoint *saved_ckp = model_factory->getCheckpoint();
+    model_factory->setCheckpoint(&model_ckp);
+    model_factory->saveCheckpoint();
+    model_factory->setCheckpoint(saved_ckp);
+    for (auto clone : gradient_clones) {
+        clone->readTreeString(tree_str);
+        clone->initializeAllPartialLh();
+        clone->getModelFactory()->setCheckpoint(&model_ckp);
+        clone->getModelFactory()->restoreCheckpoint();
+        clone->getModelFactory()->setCheckpoint(NULL);
+        clone->clearAllPartialLH();
+    }
+    return gradient_clones.size();
+}
+
+void PhyloTree::deleteGradientClones() {
+    for (auto it = gradient_clones.rbegin(); it != gradient_clones.rend(); it++)
+        delete *it;
+    gradient_clones.clear();
+}
+
 /****************************************************************************
  Branch length optimization by maximum likelihood
  ****************************************************************************/
@@ -3547,6 +3833,75 @@ double PhyloTree::computeDist_Experimental(double *dist_mat, double *var_mat) {
     return longest;
 }
 
+/**
+    variance of a distance for the least square method
+    @param ls_var_type type of variance
+    @param dist the distance
+    @param d2l second derivative of the likelihood at the distance
+    @param var current variance, kept for unknown types
+*/
+static double computeDistVariance(LEAST_SQUARE_VAR ls_var_type, double dist, double d2l, double var) {
+    if (ls_var_type == OLS)
+        return 1.0;
+    else if (ls_var_type == WLS_PAUPLIN)
+        return 0.0;
+    else if (ls_var_type == WLS_FIRST_TAYLOR)
+        return dist;
+    else if (ls_var_type == WLS_FITCH_MARGOLIASH)
+        return dist * dist;
+    else if (ls_var_type == WLS_SECOND_TAYLOR)
+        return -1.0 / d2l;
+    return var;
+}
+
+/** number of sequence pairs optimized together by AlignmentPairwiseBatch */
+const size_t DIST_PAIR_BATCH_SIZE = 256;
+
+void PhyloTree::computeDistInBatches(double *dist_mat, double *var_mat, progress_display &progress) {
+    size_t nseqs = aln->getNSeq();
+    size_t npairs = nseqs*(nseqs-1)/2;
+    size_t nbatches = (npairs + DIST_PAIR_BATCH_SIZE - 1) / DIST_PAIR_BATCH_SIZE;
+    // pair_start[seq1] is the index of the pair (seq1, seq1+1) in the upper triangle
+    vector<size_t> pair_start(nseqs, 0);
+    for (size_t seq1 = 1; seq1 < nseqs; ++seq1) {
+        pair_start[seq1] = pair_start[seq1-1] + (nseqs - seq1);
+    }
+    AlignmentPairwiseBatch batch(this);
+    // batches of equal number of pairs, rather than rows of decreasing length, balance the threads
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for (size_t b = 0; b < nbatches; ++b) {
+        size_t first = b * DIST_PAIR_BATCH_SIZE;
+        size_t count = min(DIST_PAIR_BATCH_SIZE, npairs - first);
+        IntVector seq1s(count), seq2s(count);
+        DoubleVector dists(count), d2ls(count);
+        size_t seq1 = upper_bound(pair_start.begin(), pair_start.end(), first) - pair_start.begin() - 1;
+        size_t seq2 = seq1 + 1 + (first - pair_start[seq1]);
+        for (size_t i = 0; i < count; ++i) {
+            if (seq2 == nseqs) {
+                ++seq1;
+                seq2 = seq1 + 1;
+            }
+            seq1s[i] = seq1;
+            seq2s[i] = seq2;
+            // initial guess as in AlignmentPairwise::recomputeDist()
+            dists[i] = dist_mat[seq1 * nseqs + seq2];
+            if (dists[i] == 0.0) {
+                dists[i] = AlignmentPairwise::computeInitialDist(this, seq1, seq2);
+            }
+            ++seq2;
+        }
+        batch.optimizeDists(count, seq1s.data(), seq2s.data(), dists.data(), d2ls.data());
+        for (size_t i = 0; i < count; ++i) {
+            size_t sym_pos = seq1s[i] * nseqs + seq2s[i];
+            dist_mat[sym_pos] = dists[i];
+            var_mat[sym_pos] = computeDistVariance(params->ls_var_type, dists[i], d2ls[i], var_mat[sym_pos]);
+        }
+        progress += count;
+    }
+}
+
 double PhyloTree::computeDist(double *dist_mat, double *var_mat) {
     prepareToComputeDistances();
     size_t nseqs = aln->getNSeq();
@@ -3555,33 +3910,28 @@ double PhyloTree::computeDist(double *dist_mat, double *var_mat) {
     double baseTime = getRealTime();
     progress_display progress(nseqs*(nseqs-1)/2, "Calculating distance matrix"); //zork
     //compute the upper-triangle of distance matrix
-    #ifdef _OPENMP
-    #pragma omp parallel for schedule(dynamic)
-    #endif
-    for (size_t seq1 = 0; seq1 < nseqs; ++seq1) {
+    if (!params->compute_obs_dist && AlignmentPairwiseBatch::isApplicable(this)) {
+        computeDistInBatches(dist_mat, var_mat, progress);
+    } else {
         #ifdef _OPENMP
-            int threadNum = omp_get_thread_num();
-            AlignmentPairwise* processor = distanceProcessors[threadNum];
-        #else
-            AlignmentPairwise* processor = distanceProcessors[0];
+        #pragma omp parallel for schedule(dynamic)
         #endif
-        int rowStartPos = seq1 * nseqs;
-        for (size_t seq2=seq1+1; seq2 < nseqs; ++seq2) {
-            size_t sym_pos = rowStartPos + seq2;
-            double d2l = var_mat[sym_pos]; // moved here for thread-safe (OpenMP)
-            dist_mat[sym_pos] = processor->recomputeDist(seq1, seq2, dist_mat[sym_pos], d2l);
-            if (params->ls_var_type == OLS)
-                var_mat[sym_pos] = 1.0;
-            else if (params->ls_var_type == WLS_PAUPLIN)
-                var_mat[sym_pos] = 0.0;
-            else if (params->ls_var_type == WLS_FIRST_TAYLOR)
-                var_mat[sym_pos] = dist_mat[sym_pos];
-            else if (params->ls_var_type == WLS_FITCH_MARGOLIASH)
-                var_mat[sym_pos] = dist_mat[sym_pos] * dist_mat[sym_pos];
-            else if (params->ls_var_type == WLS_SECOND_TAYLOR)
-                var_mat[sym_pos] = -1.0 / d2l;
-        }
-        progress += (nseqs - seq1 - 1);
+        for (size_t seq1 = 0; seq1 < nseqs; ++seq1) {
+            #ifdef _OPENMP
+                int threadNum = omp_get_thread_num();
+                AlignmentPairwise* processor = distanceProcessors[threadNum];
+            #else
+                AlignmentPairwise* processor = distanceProcessors[0];
+            #endif
+            int rowStartPos = seq1 * nseqs;
+            for (size_t seq2=seq1+1; seq2 < nseqs; ++seq2) {
+                size_t sym_pos = rowStartPos + seq2;
+                double d2l = var_mat[sym_pos]; // moved here for thread-safe (OpenMP)
+                dist_mat[sym_pos] = processor->recomputeDist(seq1, seq2, dist_mat[sym_pos], d2l);
+                var_mat[sym_pos] = computeDistVariance(params->ls_var_type, dist_mat[sym_pos], d2l, var_mat[sym_pos]);
+            }
+            progress += (nseqs - seq1 - 1);
+        }
     }
     //cout << (getRealTime()-baseTime) << "s Copying to lower triangle" << endl;
     //copy upper-triangle into lower-triangle and set diagonal = 0
@@ -3708,6 +4058,9 @@ void PhyloTree::computeBioNJ(Params &params) {
     string bionj_file = params.out_prefix;
     bionj_file += ".bionj";
     this->decideDistanceFilePath(params);
+    if (params.dist_mmap_dir) {
+        StartTree::setMatrixFileDirectory(params.dist_mmap_dir);
+    }
     auto treeBuilder
         = StartTree::Factory::getTreeBuilderByName
             ( params.start_tree_subtype_name);
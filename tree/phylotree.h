@@ -49,6 +49,7 @@
 #include "utils/progress.h"
 
 class AlignmentPairwise;
+class BootWeights;
 
 #define BOOT_VAL_FLOAT
 #define BootValType float
@@ -78,6 +79,9 @@ const double TOL_LIKELIHOOD_PARAMOPT = 0.001; // BQM: newly introduced for Model
 //#define SCALING_THRESHOLD ldexp(1.0, -256)
 //#define LOG_SCALING_THRESHOLD log(SCALING_THRESHOLD)
 #define LOG_SCALING_THRESHOLD -177.4456782233459932741
+// 2^{-128}: scaling threshold when partial likelihoods are stored as float,
+// such that scaled values (times 2^256) still fit into single precision
+#define SCALING_THRESHOLD_FLOAT 2.938735877055718769921841e-39
 
 const int SPR_DEPTH = 2;
 
@@ -334,6 +338,29 @@ public:
 // END traversal information
 // ********************************************
 
+/**
+    derivatives of the tree log-likelihood, see PhyloTree::computeLikelihoodGradient()
+*/
+struct LikelihoodGradient {
+    /**
+        derivative w.r.t. the rate matrix Q in its eigenbasis, such that
+        d lnL = sum_ij eigen_grad[i*nstates+j] * (U^-1 dQ U)_ij with U the eigenvectors
+    */
+    DoubleVector eigen_grad;
+
+    /** derivative w.r.t. the normalized state frequencies at the root, holding Q fixed */
+    DoubleVector freq_grad;
+
+    /** derivative w.r.t. the rate of each category */
+    DoubleVector rate_grad;
+
+    /** derivative w.r.t. the proportion of each category */
+    DoubleVector prop_grad;
+
+    /** derivative w.r.t. the proportion of invariable sites */
+    double invar_grad;
+};
+
 
 /**
 Phylogenetic Tree class
@@ -608,6 +635,27 @@ public:
     typedef BootValType (PhyloTree::*DotProductType)(BootValType *x, BootValType *y, int size);
     DotProductType dotProduct;
 
+    /**
+        RELL scores of several trees on several bootstrap samples as a cache-blocked
+        matrix product, equal to calling dotProduct for each (sample, tree) pair
+        @param pattern_lh pattern log-likelihoods of ntrees trees, one row per tree
+        @param ntrees number of trees
+        @param samples pattern frequencies of all bootstrap samples, one row per sample, NULL if weights is used
+        @param weights compact pattern frequencies decoded on the fly, NULL if samples is used
+        @param first_sample first bootstrap sample
+        @param nsamples number of bootstrap samples
+        @param stride distance between two rows of pattern_lh or samples
+        @param nptn number of patterns
+        @param[out] rell RELL scores, rell[sample*ntrees+tree] for sample counted from first_sample
+    */
+    template <class Numeric, class VectorClass>
+    void computeRELLSIMD(Numeric *pattern_lh, int ntrees, Numeric *samples, BootWeights *weights,
+                         int first_sample, int nsamples, size_t stride, int nptn, Numeric *rell);
+
+    typedef void (PhyloTree::*ComputeRELLType)(BootValType *pattern_lh, int ntrees, BootValType *samples, BootWeights *weights,
+                                               int first_sample, int nsamples, size_t stride, int nptn, BootValType *rell);
+    ComputeRELLType computeRELL;
+
     typedef double (PhyloTree::*DotProductDoubleType)(double *x, double *y, int size);
     DotProductDoubleType dotProductDouble;
 
@@ -699,6 +747,54 @@ public:
 
     template<class VectorClass>
     int computeParsimonyBranchSankoffSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, int *branch_subst = NULL);
+
+    typedef void (PhyloTree::*ComputePartialParsimonyJoinType)(PhyloNeighbor *, PhyloNeighbor *, UINT *);
+    ComputePartialParsimonyJoinType computePartialParsimonyJoinPointer;
+
+    /**
+            compute partial parsimony of two subtrees joined by a new node, without changing the tree.
+            Used to re-root partial parsimony incrementally around a pruned subtree
+            @param left_branch branch leading to the first subtree, its partial parsimony must be computed
+            @param right_branch branch leading to the second subtree, its partial parsimony must be computed
+            @param[out] partial_pars partial parsimony of the joined subtree, of getBitsBlockSize() entries
+     */
+    void computePartialParsimonyJoin(PhyloNeighbor *left_branch, PhyloNeighbor *right_branch, UINT *partial_pars) {
+        (this->*computePartialParsimonyJoinPointer)(left_branch, right_branch, partial_pars);
+    }
+    void computePartialParsimonyJoinFast(PhyloNeighbor *left_branch, PhyloNeighbor *right_branch, UINT *partial_pars);
+    template<class VectorClass>
+    void computePartialParsimonyJoinFastSIMD(PhyloNeighbor *left_branch, PhyloNeighbor *right_branch, UINT *partial_pars);
+    template<class VectorClass>
+    void computePartialParsimonyJoinSankoffSIMD(PhyloNeighbor *left_branch, PhyloNeighbor *right_branch, UINT *partial_pars);
+
+    typedef int (PhyloTree::*ComputeParsimonyInsertType)(PhyloNeighbor *, PhyloNeighbor *, PhyloNeighbor *);
+    ComputeParsimonyInsertType computeParsimonyInsertPointer;
+
+    /**
+            compute tree parsimony score after inserting a subtree into a branch, without changing the tree.
+            It only reads partial parsimony, thus different insertions can be scored concurrently
+            @param dad_branch branch leading to the subtree on one side of the target branch
+            @param node_branch branch leading to the subtree on the other side of the target branch
+            @param added_branch branch leading to the subtree to insert
+            all three partial parsimony must be computed, except for leaves with Sankoff parsimony
+            @return parsimony score of the tree with the subtree inserted
+     */
+    int computeParsimonyInsert(PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch, PhyloNeighbor *added_branch) {
+        return (this->*computeParsimonyInsertPointer)(dad_branch, node_branch, added_branch);
+    }
+    int computeParsimonyInsertFast(PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch, PhyloNeighbor *added_branch);
+    template<class VectorClass>
+    int computeParsimonyInsertFastSIMD(PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch, PhyloNeighbor *added_branch);
+    template<class VectorClass>
+    int computeParsimonyInsertSankoffSIMD(PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch, PhyloNeighbor *added_branch);
+
+    /**
+            compute partial parsimony of the given branches and the ones they depend on.
+            Vectors of the same height in the tree are computed in parallel
+            @param branches branches whose partial parsimony is needed
+            @param dads the corresponding dads
+     */
+    void computePartialParsimonyParallel(NeighborVec &branches, NodeVector &dads);
     
 //    void printParsimonyStates(PhyloNeighbor *dad_branch = NULL, PhyloNode *dad = NULL);
 
@@ -762,6 +858,15 @@ public:
 
     size_t getBufferPartialLhSize();
 
+    /**
+            get the per-packet scratch memory (3 blocks of pattern vectors) at the end of buffer_partial_lh
+            used to unpack single-precision partial likelihoods for computation
+            @param block number of partial likelihood entries per pattern
+            @param vsize vector size of the SIMD kernel
+            @param packet_id packet ID
+     */
+    double *getBufferPartialLhFloat(size_t block, size_t vsize, int packet_id);
+
     /**
             initialize partial_lh vector of all PhyloNeighbors, allocating central_partial_lh
      */
@@ -834,9 +939,15 @@ public:
     /** true if using safe numeric for likelihood kernel */
     bool safe_numeric;
 
+    /** true if partial_lh vectors are stored in single precision (--lh-float) */
+    bool partial_lh_float;
+
     /** number of threads used for likelihood kernel */
     int num_threads;
 
+    /** copies of this tree evaluating the likelihood concurrently, see prepareGradientClones() */
+    vector<PhyloTree*> gradient_clones;
+
     /** number of packets used for likelihood kernel (typically more) */
     int num_packets;
 
@@ -944,6 +1055,39 @@ public:
      */
     virtual double computeLikelihoodBranch(PhyloNeighbor *dad_branch, PhyloNode *dad, bool save_log_value = true);
 
+    /**
+            @return true if computeLikelihoodGradient() supports the current model and tree
+     */
+    bool isLikelihoodGradientSupported();
+
+    /**
+            compute the derivatives of the tree log-likelihood w.r.t. the rate matrix, root frequencies
+            and rate heterogeneity in one pass over the partial likelihoods of all branches.
+            The likelihood must have been computed for the current parameters.
+            @param[out] grad the derivatives
+            @return false if not supported, see isLikelihoodGradientSupported()
+     */
+    bool computeLikelihoodGradient(LikelihoodGradient &grad);
+
+    /**
+            prepare copies of this tree and its model to evaluate the likelihood concurrently
+            with this tree (--thread-grad), one per further thread. The copies are created once
+            and synchronized with the current tree and model parameters on every call.
+            @return number of copies, 0 if not used
+     */
+    int prepareGradientClones();
+
+    /**
+            @param id copy ID, 0 <= id < prepareGradientClones()
+            @return the copy
+     */
+    PhyloTree *getGradientClone(int id) {
+        return gradient_clones[id];
+    }
+
+    /** delete all copies created by prepareGradientClones() */
+    void deleteGradientClones();
+
     typedef double (PhyloTree::*ComputeLikelihoodBranchType)(PhyloNeighbor*, PhyloNode*, bool);
     ComputeLikelihoodBranchType computeLikelihoodBranchPointer;
 
@@ -1395,6 +1539,14 @@ public:
      * @return parsimony score
      */
     virtual int computeParsimonyTree(const char *out_prefix, Alignment *alignment, int *rand_stream);
+
+    /**
+     * improve the tree by subtree pruning and regrafting with maximum parsimony.
+     * Regraft positions of each subtree are scored concurrently
+     * @param radius maximal number of branches between the pruned and regrafted position
+     * @return parsimony score of the tree
+     */
+    int optimizeSPRParsimony(int radius);
         
     /****************************************************************************
             Branch length optimization by maximum likelihood
@@ -1716,6 +1868,15 @@ public:
      */
     double computeDist(double *dist_mat, double *var_mat);
 
+    /**
+            compute the upper triangle of the distance and variance matrices with
+            AlignmentPairwiseBatch, in batches of pairs distributed over the threads
+            @param dist_mat (IN/OUT) distance matrix, nonzero entries are the initial guesses
+            @param var_mat (OUT) variance matrix for distance matrix
+            @param progress progress of the pairs computed
+     */
+    void computeDistInBatches(double *dist_mat, double *var_mat, progress_display &progress);
+
     double computeDist_Experimental(double *dist_mat, double *var_mat);
     
     /**
@@ -302,6 +302,119 @@ int PhyloTree::computeParsimonyBranchFast(PhyloNeighbor *dad_branch, PhyloNode *
     return score;
 }
 
+void PhyloTree::computePartialParsimonyJoinFast(PhyloNeighbor *left_branch, PhyloNeighbor *right_branch, UINT *partial_pars) {
+    int nstates = aln->getMaxNumStates();
+    int nsites = (aln->num_parsimony_sites + UINT_BITS-1) / UINT_BITS;
+    UINT *left = left_branch->partial_pars, *right = right_branch->partial_pars;
+    UINT score = 0;
+
+    for (int site = 0; site < nsites; site++) {
+        size_t offset = nstates*site;
+        UINT *x = left + offset;
+        UINT *y = right + offset;
+        UINT *z = partial_pars + offset;
+        UINT w = 0;
+        int i;
+        for (i = 0; i < nstates; i++) {
+            z[i] = x[i] & y[i];
+            w |= z[i];
+        }
+        w = ~w;
+        score += vml_popcnt(w);
+        for (i = 0; i < nstates; i++) {
+            z[i] |= w & (x[i] | y[i]);
+        }
+    }
+    partial_pars[nstates*nsites] = score + left[nstates*nsites] + right[nstates*nsites];
+}
+
+int PhyloTree::computeParsimonyInsertFast(PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch, PhyloNeighbor *added_branch) {
+    int nstates = aln->getMaxNumStates();
+    int nsites = (aln->num_parsimony_sites + UINT_BITS-1) / UINT_BITS;
+    UINT *xpars = dad_branch->partial_pars, *ypars = node_branch->partial_pars, *spars = added_branch->partial_pars;
+    int scoreid = nstates*nsites;
+    UINT score = xpars[scoreid] + ypars[scoreid] + spars[scoreid];
+
+    for (int site = 0; site < nsites; site++) {
+        size_t offset = nstates*site;
+        UINT *x = xpars + offset;
+        UINT *y = ypars + offset;
+        UINT *s = spars + offset;
+        // join the two sides of the branch, then attach the subtree
+        UINT w = 0, v = 0;
+        int i;
+        for (i = 0; i < nstates; i++)
+            w |= x[i] & y[i];
+        w = ~w;
+        for (i = 0; i < nstates; i++)
+            v |= ((x[i] & y[i]) | (w & (x[i] | y[i]))) & s[i];
+        v = ~v;
+        score += vml_popcnt(w) + vml_popcnt(v);
+    }
+    return score;
+}
+
+/**
+    collect the partial parsimony vectors needed for a branch that are not computed yet
+    @param dad_branch the branch leading to the subtree
+    @param dad its dad, used to direct the traversal
+    @param sankoff true if leaves have no partial parsimony vector
+    @param[in,out] heights height of the collected vectors above computed ones
+    @param[out] level_branches level_dads collected vectors grouped by height
+    @return height of the vector of dad_branch, 0 if it is already computed
+*/
+static int collectUncomputedPartialPars(PhyloNeighbor *dad_branch, PhyloNode *dad, bool sankoff,
+                                        unordered_map<PhyloNeighbor*, int> &heights,
+                                        vector<NeighborVec> &level_branches, vector<NodeVector> &level_dads)
+{
+    if (dad_branch->get_partial_lh_computed() & 2)
+        return 0;
+    PhyloNode *node = (PhyloNode*)dad_branch->node;
+    if (sankoff && node->isLeaf())
+        return 0;
+    auto found = heights.find(dad_branch);
+    if (found != heights.end())
+        return found->second;
+    int height = 1;
+    if (node->name != ROOT_NAME) {
+        FOR_NEIGHBOR_IT(node, dad, it) {
+            int child_height = collectUncomputedPartialPars((PhyloNeighbor*)*it, node, sankoff, heights, level_branches, level_dads);
+            height = max(height, child_height + 1);
+        }
+    }
+    heights[dad_branch] = height;
+    if (level_branches.size() < height) {
+        level_branches.resize(height);
+        level_dads.resize(height);
+    }
+    level_branches[height-1].push_back(dad_branch);
+    level_dads[height-1].push_back(dad);
+    return height;
+}
+
+void PhyloTree::computePartialParsimonyParallel(NeighborVec &branches, NodeVector &dads) {
+    if (!central_partial_pars)
+        initializeAllPartialPars();
+    int threads = max(num_threads, 1);
+    unordered_map<PhyloNeighbor*, int> heights;
+    vector<NeighborVec> level_branches;
+    vector<NodeVector> level_dads;
+    for (size_t i = 0; i < branches.size(); i++)
+        collectUncomputedPartialPars((PhyloNeighbor*)branches[i], (PhyloNode*)dads[i], cost_matrix != NULL,
+                                     heights, level_branches, level_dads);
+    // vectors of the same height only depend on lower ones
+    for (size_t level = 0; level < level_branches.size(); level++) {
+        NeighborVec &level_branch = level_branches[level];
+        NodeVector &level_dad = level_dads[level];
+        int num_level = level_branch.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(threads) if(threads > 1 && num_level > 1)
+#endif
+        for (int i = 0; i < num_level; i++)
+            computePartialParsimony((PhyloNeighbor*)level_branch[i], (PhyloNode*)level_dad[i]);
+    }
+}
+
 void PhyloTree::computeAllPartialPars(PhyloNode *node, PhyloNode *dad) {
 	if (!node) node = (PhyloNode*)root;
 	FOR_NEIGHBOR_IT(node, dad, it) {
@@ -1126,6 +1239,51 @@ void PhyloTree::insertNode2Branch(Node* added_node, Node* target_node, Node* tar
     ass_node->clearReversePartialLh((PhyloNode*)added_node);
 }
 
+/**
+    get the branches around the placed taxa closest to a new taxon, used by computeParsimonyTree()
+    @param tree the tree being built
+    @param taxon_id sequence ID of the new taxon
+    @param placed_taxa taxa already in the tree
+    @param num_closest number of closest taxa
+    @param radius maximal number of branches away from the closest taxa
+    @param[out] nodes1 nodes2 the candidate branches
+    @param rand_stream random stream to sample the placed taxa
+*/
+static void getParsimonyInsertBranches(PhyloTree *tree, int taxon_id, NodeVector &placed_taxa,
+                                       int num_closest, int radius, NodeVector &nodes1, NodeVector &nodes2,
+                                       int *rand_stream)
+{
+    // only a sample of placed taxa, otherwise the distances are quadratic again
+    const size_t max_sample = 1000;
+    NodeVector sample;
+    if (placed_taxa.size() <= max_sample)
+        sample = placed_taxa;
+    else
+        for (size_t i = 0; i < max_sample; i++)
+            sample.push_back(placed_taxa[random_int(placed_taxa.size(), rand_stream)]);
+    int num_sample = sample.size();
+    vector<pair<double, int> > dists(num_sample);
+    int threads = max(tree->num_threads, 1);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+#endif
+    for (int i = 0; i < num_sample; i++)
+        dists[i] = make_pair(tree->aln->computeObsDist(taxon_id, sample[i]->id), i);
+    int num = min(num_closest, num_sample);
+    partial_sort(dists.begin(), dists.begin() + num, dists.end());
+
+    set<pair<int, int> > found;
+    for (int i = 0; i < num; i++) {
+        NodeVector near1, near2;
+        tree->getBranches(radius, near1, near2, sample[dists[i].second], NULL);
+        for (size_t j = 0; j < near1.size(); j++)
+            if (found.insert(make_pair(near1[j]->id, near2[j]->id)).second) {
+                nodes1.push_back(near1[j]);
+                nodes2.push_back(near2[j]);
+            }
+    }
+}
+
 int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment, int *rand_stream) {
     aln = alignment;
     size_t nseq = aln->getNSeq();
@@ -1138,6 +1296,8 @@ int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment
     NeighborVec removed_nei; // removed Neighbor
     NodeVector attached_node; // node attached to removed Neighbor
     NodeVector added_nodes; // newly added nodes
+    NodeVector placed_taxa; // taxa in the tree, to insert new taxa near the closest ones
+    int insert_nbh = (params) ? params->parsInsertNbh : 0;
     int newNodeID;
     size_t index;
     size_t pars_block_size = getBitsBlockSize();
@@ -1197,7 +1357,13 @@ int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment
             // add new taxon to the tree
             if (verbose_mode >= VB_MAX)
                 cout << "Adding " << aln->getSeqName(taxon_order[leafNum]) << " to the tree..." << endl;
-            getBranches(nodes1, nodes2);
+            if (insert_nbh > 0) {
+                if (placed_taxa.empty())
+                    getTaxa(placed_taxa);
+                getParsimonyInsertBranches(this, taxon_order[leafNum], placed_taxa, insert_nbh,
+                                           max(params->sprDist, 1), nodes1, nodes2, rand_stream);
+            } else
+                getBranches(nodes1, nodes2);
 
             // allocate a new taxon
             new_taxon = (PhyloNode*)newNode(taxon_order[leafNum], aln->getSeqName(taxon_order[leafNum]).c_str());
@@ -1214,6 +1380,41 @@ int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment
         added_node->addNeighbor((Node*) 1, -1.0);
         added_node->addNeighbor((Node*) 2, -1.0);
 
+        if (computeParsimonyInsertPointer) {
+            // score all branches concurrently, only reading the partial parsimony
+            int num_branches = nodes1.size();
+            NeighborVec branches;
+            NodeVector dads;
+            branches.reserve(2*num_branches+1);
+            dads.reserve(2*num_branches+1);
+            for (int nodeid = 0; nodeid < num_branches; nodeid++) {
+                branches.push_back(nodes2[nodeid]->findNeighbor(nodes1[nodeid]));
+                dads.push_back(nodes2[nodeid]);
+                branches.push_back(nodes1[nodeid]->findNeighbor(nodes2[nodeid]));
+                dads.push_back(nodes1[nodeid]);
+            }
+            PhyloNeighbor *added_branch = (PhyloNeighbor*)added_node->findNeighbor(new_taxon);
+            branches.push_back(added_branch);
+            dads.push_back(added_node);
+            computePartialParsimonyParallel(branches, dads);
+
+            vector<int> scores(num_branches);
+            int threads = max(num_threads, 1);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+#endif
+            for (int nodeid = 0; nodeid < num_branches; nodeid++)
+                scores[nodeid] = computeParsimonyInsert((PhyloNeighbor*)branches[2*nodeid],
+                    (PhyloNeighbor*)branches[2*nodeid+1], added_branch);
+
+            // the first best branch, as in the serial loop below
+            for (int nodeid = 0; nodeid < num_branches; nodeid++)
+                if (scores[nodeid] < best_pars_score) {
+                    best_pars_score = scores[nodeid];
+                    target_node = (PhyloNode*)nodes1[nodeid];
+                    target_dad = (PhyloNode*)nodes2[nodeid];
+                }
+        } else
         for (int nodeid = 0; nodeid < nodes1.size(); nodeid++) {
         
             int score = addTaxonMPFast(new_taxon, added_node, nodes1[nodeid], nodes2[nodeid]);
@@ -1235,15 +1436,21 @@ int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment
         ((PhyloNeighbor*)target_node->findNeighbor(added_node))->clearPartialLh();
         ((PhyloNeighbor*)target_node->findNeighbor(added_node))->partial_pars = central_partial_pars + ((index++) * pars_block_size);
 
-        target_dad->clearReversePartialLh(added_node);
-        target_node->clearReversePartialLh(added_node);
+        target_dad->clearReversePartialPars(added_node);
+        target_node->clearReversePartialPars(added_node);
 
         // increase number of taxa
         leafNum += getNumTaxa(new_taxon, added_node);
+        if (!placed_taxa.empty())
+            placed_taxa.push_back(new_taxon);
     }
     
     ASSERT(index == 4*leafNum-6);
 
+    // SPR moves would break the constraint tree
+    if (params && params->sprDist > 0 && constraintTree.empty())
+        best_pars_score = optimizeSPRParsimony(params->sprDist);
+
     nodeNum = 2 * leafNum - 2;
     initializeTree();
     // parsimony tree is always unrooted
@@ -1294,6 +1501,191 @@ int PhyloTree::addTaxonMPFast(Node *added_taxon, Node* added_node, Node* node, N
 
 }
 
+/**
+    a regraft position of a pruned subtree, used by optimizeSPRParsimony()
+*/
+struct ParsimonyRegraft {
+    /** upper end of the target branch */
+    PhyloNode *node;
+    /** branch leading to the subtree below the target branch */
+    PhyloNeighbor *branch;
+    /** branch leading to the rest of the tree above node */
+    PhyloNeighbor *up_branch;
+    /** index of the regraft position whose joined vector is up_branch, -1 for a real branch */
+    int parent;
+    /** branch leading to the other subtree below node */
+    PhyloNeighbor *sibling;
+    /** rest of the tree above the target branch, with partial_pars in a scratch vector */
+    PhyloNeighbor *joined;
+    /** parsimony score after regrafting */
+    int score;
+};
+
+int PhyloTree::optimizeSPRParsimony(int radius) {
+    // the score is computed in full, not bounded by a previous one
+    best_pars_score = UINT_MAX;
+    int score = computeParsimony();
+    if (leafNum < 4 || radius < 1 || !computePartialParsimonyJoinPointer || !computeParsimonyInsertPointer) {
+        best_pars_score = score;
+        return score;
+    }
+    int threads = max(num_threads, 1);
+    size_t pars_block_size = getBitsBlockSize();
+    // scratch vectors for the joined partial parsimony of each regraft position
+    vector<PhyloNeighbor*> joined_pool;
+    vector<ParsimonyRegraft> regrafts;
+    vector<size_t> level_end;
+    NeighborVec branches;
+    NodeVector dads;
+    int num_moves = 0;
+
+    for (bool improved = true; improved; ) {
+        improved = false;
+        NodeVector nodes1, nodes2;
+        getBranches(nodes1, nodes2);
+        for (size_t i = 0; i < 2*nodes1.size(); i++) {
+            // prune the subtree at node from dad, the other two neighbors of dad become joined
+            PhyloNode *node = (PhyloNode*)((i % 2 == 0) ? nodes1[i/2] : nodes2[i/2]);
+            PhyloNode *dad = (PhyloNode*)((i % 2 == 0) ? nodes2[i/2] : nodes1[i/2]);
+            if (dad->isLeaf() || !dad->isNeighbor(node))
+                continue;
+            PhyloNeighbor *pruned_branch = (PhyloNeighbor*)dad->findNeighbor(node);
+            PhyloNeighbor *dad_branches[2];
+            int k = 0;
+            FOR_NEIGHBOR_IT(dad, node, it)
+                dad_branches[k++] = (PhyloNeighbor*)*it;
+
+            // collect the regraft positions by their distance to the pruned position
+            regrafts.clear();
+            level_end.clear();
+            branches.clear();
+            dads.clear();
+            branches.push_back(pruned_branch);
+            dads.push_back(dad);
+            for (k = 0; k < 2; k++) {
+                PhyloNode *top = (PhyloNode*)dad_branches[k]->node;
+                branches.push_back(dad_branches[k]);
+                dads.push_back(dad);
+                FOR_NEIGHBOR_IT(top, dad, it) {
+                    ParsimonyRegraft regraft;
+                    regraft.node = top;
+                    regraft.branch = (PhyloNeighbor*)*it;
+                    regraft.up_branch = dad_branches[1-k];
+                    regraft.parent = -1;
+                    FOR_NEIGHBOR_IT(top, dad, it2)
+                        if (it2 != it)
+                            regraft.sibling = (PhyloNeighbor*)*it2;
+                    regrafts.push_back(regraft);
+                }
+            }
+            level_end.push_back(regrafts.size());
+            for (int level = 1; level < radius; level++) {
+                size_t level_start = (level == 1) ? 0 : level_end[level-2];
+                for (size_t j = level_start; j < level_end[level-1]; j++) {
+                    PhyloNode *top = (PhyloNode*)regrafts[j].branch->node;
+                    FOR_NEIGHBOR_IT(top, regrafts[j].node, it) {
+                        ParsimonyRegraft regraft;
+                        regraft.node = top;
+                        regraft.branch = (PhyloNeighbor*)*it;
+                        regraft.up_branch = NULL;
+                        regraft.parent = j;
+                        FOR_NEIGHBOR_IT(top, regrafts[j].node, it2)
+                            if (it2 != it)
+                                regraft.sibling = (PhyloNeighbor*)*it2;
+                        regrafts.push_back(regraft);
+                    }
+                }
+                if (regrafts.size() == level_end.back())
+                    break;
+                level_end.push_back(regrafts.size());
+            }
+            if (regrafts.empty())
+                continue;
+
+            while (joined_pool.size() < regrafts.size()) {
+                PhyloNeighbor *joined = new PhyloNeighbor(NULL, -1.0);
+                joined->partial_pars = newBitsBlock();
+                joined_pool.push_back(joined);
+            }
+            for (size_t j = 0; j < regrafts.size(); j++) {
+                ParsimonyRegraft &regraft = regrafts[j];
+                regraft.joined = joined_pool[j];
+                if (regraft.parent >= 0)
+                    regraft.up_branch = regrafts[regraft.parent].joined;
+                regraft.joined->node = regraft.node;
+                branches.push_back(regraft.branch);
+                dads.push_back(regraft.node);
+                branches.push_back(regraft.sibling);
+                dads.push_back(regraft.node);
+            }
+            computePartialParsimonyParallel(branches, dads);
+
+            // re-root the rest of the tree at each regraft position and score it
+            for (size_t level = 0; level < level_end.size(); level++) {
+                int level_start = (level == 0) ? 0 : level_end[level-1];
+                int level_stop = level_end[level];
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(threads) if(threads > 1 && level_stop - level_start > 1)
+#endif
+                for (int j = level_start; j < level_stop; j++) {
+                    ParsimonyRegraft &regraft = regrafts[j];
+                    computePartialParsimonyJoin(regraft.up_branch, regraft.sibling, regraft.joined->partial_pars);
+                    regraft.score = computeParsimonyInsert(regraft.branch, regraft.joined, pruned_branch);
+                }
+            }
+            ParsimonyRegraft *best = NULL;
+            for (auto &regraft : regrafts)
+                if (regraft.score < score && (!best || regraft.score < best->score))
+                    best = &regraft;
+            if (!best)
+                continue;
+
+            // move the pruned subtree to the best position
+            PhyloNode *top[2];
+            PhyloNeighbor *top_branches[2];
+            for (k = 0; k < 2; k++) {
+                top[k] = (PhyloNode*)dad_branches[k]->node;
+                top_branches[k] = (PhyloNeighbor*)top[k]->findNeighbor(dad);
+            }
+            PhyloNode *target_node = (PhyloNode*)best->branch->node;
+            PhyloNode *target_dad = best->node;
+            PhyloNeighbor *target_branches[2] = {best->branch, (PhyloNeighbor*)target_node->findNeighbor(target_dad)};
+            double joined_len = top_branches[0]->length + top_branches[1]->length;
+            double half_len = best->branch->length / 2;
+            top_branches[0]->node = top[1];
+            top_branches[1]->node = top[0];
+            top_branches[0]->length = top_branches[1]->length = joined_len;
+            target_branches[0]->node = target_branches[1]->node = dad;
+            dad_branches[0]->node = target_node;
+            dad_branches[1]->node = target_dad;
+            target_branches[0]->length = target_branches[1]->length = half_len;
+            dad_branches[0]->length = dad_branches[1]->length = half_len;
+
+            // clear partial parsimony that changed with the topology
+            PhyloNode *changed_dads[6] = {top[0], top[1], target_dad, target_node, dad, dad};
+            PhyloNeighbor *changed[6] = {top_branches[0], top_branches[1], target_branches[0], target_branches[1],
+                dad_branches[0], dad_branches[1]};
+            for (k = 0; k < 6; k++) {
+                changed[k]->clearPartialLh();
+                changed[k]->size = 0;
+                changed_dads[k]->clearReversePartialPars((PhyloNode*)changed[k]->node);
+            }
+            score = best->score;
+            num_moves++;
+            improved = true;
+        }
+    }
+
+    for (auto joined : joined_pool) {
+        aligned_free(joined->partial_pars);
+        delete joined;
+    }
+    if (verbose_mode >= VB_MED)
+        cout << "Parsimony SPR: " << num_moves << " moves, score " << score << endl;
+    best_pars_score = score;
+    return score;
+}
+
 void PhyloTree::extractBifurcatingSubTree(NeighborVec &removed_nei, NodeVector &attached_node, int *rand_stream) {
     NodeVector nodes;
     getMultifurcatingNodes(nodes);
@@ -58,6 +58,9 @@ void PhyloTree::setParsimonyKernel(LikelihoodKernel lk) {
         if (lk < LK_SSE2) {
             computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchSankoff;
             computePartialParsimonyPointer = &PhyloTree::computePartialParsimonySankoff;
+            // no join and insert kernels, the callers fall back to modifying the tree
+            computePartialParsimonyJoinPointer = NULL;
+            computeParsimonyInsertPointer = NULL;
             return;
         }
         if (lk >= LK_AVX) {
@@ -75,6 +78,8 @@ void PhyloTree::setParsimonyKernel(LikelihoodKernel lk) {
     if (lk < LK_SSE2) {
         computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchFast;
         computePartialParsimonyPointer = &PhyloTree::computePartialParsimonyFast;
+        computePartialParsimonyJoinPointer = &PhyloTree::computePartialParsimonyJoinFast;
+        computeParsimonyInsertPointer = &PhyloTree::computeParsimonyInsertFast;
     	return;
     }
     if (lk >= LK_AVX) {
@@ -94,6 +99,13 @@ void PhyloTree::setLikelihoodKernel(LikelihoodKernel lk) {
     vector_size = 1;
     safe_numeric = (params && (params->lk_safe_scaling || leafNum >= params->numseq_safe_scaling)) ||
         (aln && aln->num_states != 4 && aln->num_states != 20);
+    partial_lh_float = params && params->lh_float;
+    if (partial_lh_float && model_factory) {
+        if (!model_factory->model->isReversible() || params->kernel_nonrev)
+            outError("--lh-float is not supported for non-reversible models or ancestral state reconstruction");
+        if (isMixlen())
+            outError("--lh-float is not supported for branch length mixture models");
+    }
 
     //--- parsimony kernel ---
     setParsimonyKernel(lk);
@@ -119,6 +131,7 @@ void PhyloTree::setLikelihoodKernel(LikelihoodKernel lk) {
 //		dotProduct = &PhyloTree::dotProductSIMD<float, Vec1f>;
 #else
 		dotProduct = &PhyloTree::dotProductSIMD<double, Vec1d>;
+		computeRELL = &PhyloTree::computeRELLSIMD<double, Vec1d>;
 #endif
         dotProductDouble = &PhyloTree::dotProductSIMD<double, Vec1d>;
 #endif
@@ -276,6 +289,8 @@ void PhyloTree::computeTipPartialLikelihood() {
                     if (ptn+v < nptn) {
                         if (stateRow!=nullptr) {
                             state = stateRow[ptn+v];
+                        } else if (aln->hasPackedStates()) {
+                            state = aln->packed_states.getState(nodeid, ptn+v);
                         } else {
                             state = aln->at(ptn+v)[nodeid];
                         }
@@ -37,6 +37,7 @@
 #define BOOT_TAG 3 // Message to please send bootstrap trees
 #define BOOT_TREE_TAG 4 // bootstrap tree tag
 #define LOGL_CUTOFF_TAG 5 // send logl_cutoff for ultrafast bootstrap
+#define MODEL_TAG 6 // ModelFinder task sent from master to workers
 
 using namespace std;
 
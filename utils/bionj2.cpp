@@ -86,6 +86,11 @@
 #include <iostream>                  //for std::istream
 #include <vectorclass/vectorclass.h> //for Vec4d and Vec4db vector classes
 #include "progress.h"                //for progress_display
+#ifndef _WIN32
+#include <sys/mman.h>                //for mmap, munmap
+#include <unistd.h>                  //for ftruncate, close, unlink
+#include <stdlib.h>                  //for mkstemp
+#endif
 
 typedef float   NJFloat;
 typedef Vec8f   FloatVector;
@@ -304,6 +309,53 @@ template <class P> inline P* matrixAlign(P* p) {
     }
 }
 
+//Directory for temporary files backing the matrices
+//(if empty, matrices are allocated on the heap).
+static std::string matrixFileDirectory;
+
+void setMatrixFileDirectory(const std::string &directory) {
+    matrixFileDirectory = directory;
+}
+
+inline void* mapTemporaryFile(size_t byteCount) {
+    //Returns a shared mapping of a new file in matrixFileDirectory,
+    //of byteCount bytes (or nullptr if that isn't possible).
+    //The file is unlinked at once, so it disappears when unmapped
+    //(or when the process exits).  The operating system pages
+    //the matrix to and from the file, rather than to swap,
+    //so it can be larger than the physical memory.
+#ifndef _WIN32
+    if (matrixFileDirectory.empty() || byteCount==0) {
+        return nullptr;
+    }
+    std::string path = matrixFileDirectory + "/iqtree_matrix_XXXXXX";
+    std::vector<char> fileName(path.begin(), path.end());
+    fileName.push_back('\0');
+    int fd = mkstemp(fileName.data());
+    if (fd<0) {
+        return nullptr;
+    }
+    unlink(fileName.data());
+    void* mapped = nullptr;
+    if (ftruncate(fd, byteCount)==0) {
+        mapped = mmap(nullptr, byteCount, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped==MAP_FAILED) {
+            mapped = nullptr;
+        }
+    }
+    close(fd);
+    return mapped;
+#else
+    return nullptr;
+#endif
+}
+
+inline void unmapTemporaryFile(void* mapped, size_t byteCount) {
+#ifndef _WIN32
+    munmap(mapped, byteCount);
+#endif
+}
+
 template <class T=NJFloat> class Matrix
 {
     //Note 1: This is a separate class so that it can be
@@ -317,12 +369,33 @@ template <class T=NJFloat> class Matrix
     //        I had accessing them from BoundingMatrix.
     //Note 3: Perhaps there should be separate SquareMatrix
     //        and RectangularMatrix classes?
+    //Note 4: If a matrix file directory has been set (see
+    //        setMatrixFileDirectory), data is a shared mapping
+    //        of a temporary file, rather than a heap array.
 public:
     size_t n;
     size_t shrink_n; //if n reaches *this*, pack the array
     T*     data;
     T**    rows;
     T*     rowTotals; //The U vector
+    size_t mappedBytes; //size of the mapping, if data is file-backed (else 0)
+    void allocateData(size_t count) {
+        data = reinterpret_cast<T*>(mapTemporaryFile(count*sizeof(T)));
+        if (data!=nullptr) {
+            mappedBytes = count*sizeof(T);
+        } else {
+            data = new T[count];
+        }
+    }
+    void releaseData() {
+        if (0<mappedBytes) {
+            unmapTemporaryFile(data, mappedBytes);
+            mappedBytes = 0;
+        } else {
+            delete [] data;
+        }
+        data = nullptr;
+    }
     virtual void setSize(size_t rank) {
         clear();
         if (0==rank) {
@@ -335,7 +408,7 @@ public:
             if (shrink_n<100) {
                 shrink_n=0;
             }
-            data        = new T[n*w + MATRIX_ALIGNMENT/sizeof(T)];
+            allocateData(n*w + MATRIX_ALIGNMENT/sizeof(T));
             rows        = new T*[n];
             rowTotals   = new T[n];
             T *rowStart = matrixAlign(data);
@@ -392,9 +465,11 @@ public:
             rowTotals[r] = rhs.rowTotals[r];
         }
     }
-    Matrix(): n(0), shrink_n(0), data(nullptr), rows(nullptr), rowTotals(nullptr) {
+    Matrix(): n(0), shrink_n(0), data(nullptr), rows(nullptr), rowTotals(nullptr)
+        , mappedBytes(0) {
     }
-    Matrix(const Matrix& rhs): data(nullptr), rows(nullptr), rowTotals(nullptr) {
+    Matrix(const Matrix& rhs): data(nullptr), rows(nullptr), rowTotals(nullptr)
+        , mappedBytes(0) {
         assign(rhs);
     }
     virtual ~Matrix() {
@@ -402,10 +477,9 @@ public:
     }
     void clear() {
         n = 0;
-        delete [] data;
+        releaseData();
         delete [] rows;
         delete [] rowTotals;
-        data = nullptr;
         rows = nullptr;
         rowTotals = nullptr;
     }
@@ -475,7 +549,7 @@ public:
             //Move the data in the array closer to the front.
             //This also helps (but: only very slightly. 5%ish?).
             size_t   w = widthNeededFor(n);
-            T* destRow = data;
+            T* destRow = matrixAlign(data);
             for (size_t r=1; r<n; ++r) {
                 destRow += w;
                 const T* sourceRow = rows[r];
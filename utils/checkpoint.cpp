@@ -10,10 +10,22 @@
 #include "timeutil.h"
 #include "gzstream.h"
 #include <cstdio>
+#include <cstring>
+#ifdef _OPENMP
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
 
 const char* CKP_HEADER =     "--- # IQ-TREE Checkpoint ver >= 1.6";
 const char* CKP_HEADER_OLD = "--- # IQ-TREE Checkpoint";
 
+// a journal record appended to the checkpoint file is only applied if it is complete
+const char* CKP_JOURNAL_BEGIN = "--- # journal";
+const char* CKP_JOURNAL_END =   "... # end of journal";
+// struct listing the keys deleted in a journal record
+const char* CKP_DELETED = "~deleted";
+
 Checkpoint::Checkpoint() {
 	filename = "";
     prev_dump_time = 0;
@@ -22,15 +34,56 @@ Checkpoint::Checkpoint() {
     struct_name = "";
     compression = true;
     header = CKP_HEADER;
+    writer = NULL;
+    journal = false;
+    journal_base = NULL;
+    journal_base_bytes = 0;
+    journal_bytes = 0;
+    binary_arrays = false;
+}
+
+
+Checkpoint::Checkpoint(const Checkpoint &ckp) {
+    writer = NULL;
+    journal_base = NULL;
+    journal_base_bytes = 0;
+    journal_bytes = 0;
+    *this = ckp;
+}
+
+
+Checkpoint &Checkpoint::operator=(const Checkpoint &ckp) {
+    if (this == &ckp)
+        return *this;
+    map<string, string>::operator=(ckp);
+    filename = ckp.filename;
+    prev_dump_time = ckp.prev_dump_time;
+    dump_interval = ckp.dump_interval;
+    dump_count = ckp.dump_count;
+    compression = ckp.compression;
+    header = ckp.header;
+    struct_name = ckp.struct_name;
+    list_element = ckp.list_element;
+    list_element_precision = ckp.list_element_precision;
+    binary_arrays = ckp.binary_arrays;
+    // the file of the copy is rewritten at the first dump
+    setJournal(ckp.journal);
+    return *this;
 }
 
 
 Checkpoint::~Checkpoint() {
+    // the writer finishes the last dump before stopping
+    if (writer)
+        delete writer;
+    if (journal_base)
+        delete journal_base;
 }
 
 
 void Checkpoint::setFileName(string filename) {
 	this->filename = filename;
+    setJournal(journal);
 }
 
 
@@ -39,8 +92,32 @@ void Checkpoint::load(istream &in) {
     string struct_name;
     size_t pos;
     int listid = 0;
+    string deleted_struct = string(CKP_DELETED) + CKP_SEP;
+    // entries of the current journal record, NULL outside of a record
+    map<string, string> *record = NULL;
+    StrVector record_deleted;
     while (!in.eof()) {
         safeGetline(in, line);
+        line.erase(line.find_last_not_of("\n\r\t")+1);
+        if (line == CKP_JOURNAL_BEGIN) {
+            if (!record)
+                record = new map<string, string>;
+            record->clear();
+            record_deleted.clear();
+            struct_name = "";
+            continue;
+        }
+        if (line == CKP_JOURNAL_END && record) {
+            for (auto key : record_deleted)
+                erase(key);
+            for (auto it : *record)
+                (*this)[it.first] = it.second;
+            delete record;
+            record = NULL;
+            struct_name = "";
+            continue;
+        }
+        map<string, string> &entries = record ? *record : *this;
         pos = line.find('#');
         if (pos != string::npos)
             line.erase(pos);
@@ -56,7 +133,7 @@ void Checkpoint::load(istream &in) {
         pos = line.find(": ");
         if (pos != string::npos) {
             // mapping
-            (*this)[struct_name + line.substr(0, pos)] = line.substr(pos+2);
+            entries[struct_name + line.substr(0, pos)] = line.substr(pos+2);
         } else if (line[line.length()-1] == ':') {
             // start a new struct
             line.erase(line.length()-1);
@@ -64,12 +141,19 @@ void Checkpoint::load(istream &in) {
             struct_name = line + CKP_SEP;
             listid = 0;
             continue;
+        } else if (struct_name == deleted_struct) {
+            // key deleted by a journal record
+            if (record)
+                record_deleted.push_back(line);
         } else {
             // collection
-            (*this)[struct_name + convertIntToString(listid)] = line;
+            entries[struct_name + convertIntToString(listid)] = line;
             listid++;
         }
     }
+    // incomplete record of an interrupted dump
+    if (record)
+        delete record;
 }
 
 
@@ -94,6 +178,8 @@ bool Checkpoint::load() {
         	throw ("Invalid checkpoint file " + filename);
         // call load from the stream
         load(in);
+        // the first dump rewrites the file
+        setJournal(journal);
         in.clear();
         // set the failbit again
         in.exceptions(ios::failbit | ios::badbit);
@@ -126,15 +212,17 @@ void Checkpoint::setDumpInterval(double interval) {
 }
 
 void Checkpoint::dump(ostream &out) {
+    dump(*this, out);
+}
+
+void Checkpoint::dump(const map<string, string> &entries, ostream &out) {
     string struct_name;
     size_t pos;
-    int listid = 0;
-    for (iterator i = begin(); i != end(); i++) {
+    for (auto i = entries.begin(); i != entries.end(); i++) {
         if ((pos = i->first.find(CKP_SEP)) != string::npos) {
             if (struct_name != i->first.substr(0, pos)) {
                 struct_name = i->first.substr(0, pos);
                 out << struct_name << ':' << endl;
-                listid = 0;
             }
             // check if key is a collection
             out << ' ' << i->first.substr(pos+1) << ": " << i->second << endl;
@@ -143,68 +231,433 @@ void Checkpoint::dump(ostream &out) {
     }
 }
 
-void Checkpoint::dump(bool force) {
-    if (filename == "")
-        return;
-        
-    if (!force && getRealTime() < prev_dump_time + dump_interval) {
-        return;
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+string encodeCkpDoubles(const double *value, size_t num) {
+    // IEEE 754 bytes in little-endian order, independent of the machine
+    string bytes(num*8, 0);
+    for (size_t i = 0; i < num; i++) {
+        uint64_t bits;
+        memcpy(&bits, value+i, 8);
+        for (int j = 0; j < 8; j++)
+            bytes[i*8+j] = (char)((bits >> (8*j)) & 0xFF);
     }
-    prev_dump_time = getRealTime();
-    string filename_tmp = filename + ".tmp";
-    if (fileExists(filename_tmp)) {
-        outWarning("IQ-TREE was killed while writing temporary checkpoint file " + filename_tmp);
-        outWarning("You should increase checkpoint interval from the default 60 seconds");
-        outWarning("via -cptime option to avoid too frequent checkpoint for large datasets");
+    string str = CKP_BINARY_PREFIX;
+    str.reserve(str.length() + (bytes.length()+2)/3*4);
+    for (size_t i = 0; i < bytes.length(); i += 3) {
+        uint32_t triple = (uint32_t)(unsigned char)bytes[i] << 16;
+        if (i+1 < bytes.length()) triple |= (uint32_t)(unsigned char)bytes[i+1] << 8;
+        if (i+2 < bytes.length()) triple |= (uint32_t)(unsigned char)bytes[i+2];
+        str += base64_chars[(triple >> 18) & 63];
+        str += base64_chars[(triple >> 12) & 63];
+        str += (i+1 < bytes.length()) ? base64_chars[(triple >> 6) & 63] : '=';
+        str += (i+2 < bytes.length()) ? base64_chars[triple & 63] : '=';
     }
+    return str;
+}
+
+bool decodeCkpDoubles(const string &str, vector<double> &value) {
+    size_t prefix_len = strlen(CKP_BINARY_PREFIX);
+    if (str.compare(0, prefix_len, CKP_BINARY_PREFIX) != 0)
+        return false;
+    string bytes;
+    uint32_t bits = 0;
+    int nbits = 0;
+    for (size_t i = prefix_len; i < str.length() && str[i] != '='; i++) {
+        const char *c = strchr(base64_chars, str[i]);
+        if (!c || !*c)
+            outError("Invalid binary array in checkpoint: ", str);
+        bits = (bits << 6) | (uint32_t)(c - base64_chars);
+        nbits += 6;
+        if (nbits >= 8) {
+            nbits -= 8;
+            bytes += (char)((bits >> nbits) & 0xFF);
+        }
+    }
+    if (bytes.length() % 8 != 0)
+        outError("Invalid binary array in checkpoint: ", str);
+    value.resize(bytes.length() / 8);
+    for (size_t i = 0; i < value.size(); i++) {
+        uint64_t word = 0;
+        for (int j = 0; j < 8; j++)
+            word |= (uint64_t)(unsigned char)bytes[i*8+j] << (8*j);
+        memcpy(&value[i], &word, 8);
+    }
+    return true;
+}
+
+/**
+    write checkpoint entries into a file
+    @param entries key-value entries
+    @param filename file name
+    @param header header line
+    @param compression true to gzip the file
+    @param via_tmp true to write a temporary file first and rename it to filename
+    @throw error message if writing fails
+*/
+static void writeCheckpointFile(const map<string, string> &entries, const string &filename,
+                                const string &header, bool compression, bool via_tmp)
+{
+    string filename_tmp = via_tmp ? filename + ".tmp" : filename;
     try {
         ostream *out;
-        if (compression) 
+        if (compression)
             out = new ogzstream(filename_tmp.c_str());
         else
             out = new ofstream(filename_tmp.c_str());
         out->exceptions(ios::failbit | ios::badbit);
         *out << header << endl;
         // call dump stream
-        dump(*out);
+        Checkpoint::dump(entries, *out);
         if (compression)
             ((ogzstream*)out)->close();
         else
             ((ofstream*)out)->close();
         delete out;
-//        cout << "Checkpoint dumped" << endl;
-        if (fileExists(filename)) {
-            if (std::remove(filename.c_str()) != 0)
-                outError("Cannot remove file ", filename);
+    } catch (ios::failure &) {
+        throw ERR_WRITE_OUTPUT + filename;
+    }
+    if (!via_tmp)
+        return;
+    if (fileExists(filename)) {
+        if (std::remove(filename.c_str()) != 0)
+            throw "Cannot remove file " + filename;
+    }
+    if (std::rename(filename_tmp.c_str(), filename.c_str()) != 0)
+        throw "Cannot rename file " + filename_tmp;
+}
+
+/**
+    append a journal record to a checkpoint file, as a new gzip member if compressed
+    @param changed new or changed entries
+    @param deleted deleted keys
+    @param filename file name
+    @param compression true if the file is compressed
+    @throw error message if writing fails
+*/
+static void appendCheckpointJournal(const map<string, string> &changed, const StrVector &deleted,
+                                    const string &filename, bool compression)
+{
+    try {
+        ostream *out;
+        if (compression)
+            out = new ogzstream(filename.c_str(), ios::out | ios::app);
+        else
+            out = new ofstream(filename.c_str(), ios::out | ios::app);
+        out->exceptions(ios::failbit | ios::badbit);
+        *out << CKP_JOURNAL_BEGIN << endl;
+        Checkpoint::dump(changed, *out);
+        if (!deleted.empty()) {
+            *out << CKP_DELETED << ':' << endl;
+            for (auto key : deleted)
+                *out << ' ' << key << endl;
         }
-        if (std::rename(filename_tmp.c_str(), filename.c_str()) != 0)
-            outError("Cannot rename file ", filename_tmp);
+        *out << CKP_JOURNAL_END << endl;
+        if (compression)
+            ((ogzstream*)out)->close();
+        else
+            ((ofstream*)out)->close();
+        delete out;
     } catch (ios::failure &) {
-        outError(ERR_WRITE_OUTPUT, filename.c_str());
+        throw ERR_WRITE_OUTPUT + filename;
     }
+}
+
+/** entries of one dump to be written */
+struct CheckpointDump {
+    /** all entries, or the changed entries if append */
+    map<string, string> entries;
+
+    /** deleted keys if append */
+    StrVector deleted;
+
+    /** true to append a journal record, false to rewrite the file */
+    bool append;
+
+    /** file names, header and compression */
+    string filename, all_filename, header;
+    bool compression;
+
+    /** write the dump, @throw error message if writing fails */
+    void write() {
+        if (append) {
+            appendCheckpointJournal(entries, deleted, filename, compression);
+            return;
+        }
+        writeCheckpointFile(entries, filename, header, compression, true);
+        if (!all_filename.empty())
+            writeCheckpointFile(entries, all_filename, header, compression, false);
+    }
+};
+
+#ifdef _OPENMP
+
+/**
+    thread writing checkpoint snapshots in the background, such that
+    serializing and compressing a large checkpoint does not block the tree search
+*/
+class CheckpointWriter {
+public:
+
+    CheckpointWriter() {
+        job = NULL;
+        busy = false;
+        stop = false;
+        worker = thread(&CheckpointWriter::run, this);
+    }
+
+    /** write the pending dump and stop the thread */
+    ~CheckpointWriter() {
+        {
+            unique_lock<mutex> lock(mtx);
+            stop = true;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+
+    /** @return true if a dump is being written */
+    bool isBusy() {
+        lock_guard<mutex> lock(mtx);
+        return busy;
+    }
+
+    /**
+        hand off a dump to the writer, the writer must not be busy
+        @param dump entries to be written, deleted by the writer
+    */
+    void submit(CheckpointDump *dump) {
+        {
+            unique_lock<mutex> lock(mtx);
+            ASSERT(!busy);
+            job = dump;
+            busy = true;
+        }
+        cv.notify_all();
+    }
+
+    /**
+        wait until the last dump is written
+        @return error message of the last writing, empty if successful
+    */
+    string wait() {
+        unique_lock<mutex> lock(mtx);
+        cv.wait(lock, [this] { return !busy; });
+        string msg = error;
+        error = "";
+        return msg;
+    }
+
+protected:
+
+    void run() {
+        unique_lock<mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [this] { return job || stop; });
+            if (!job)
+                break;
+            CheckpointDump *dump = job;
+            job = NULL;
+            lock.unlock();
+            string msg;
+            try {
+                dump->write();
+            } catch (string &str) {
+                msg = str;
+            }
+            delete dump;
+            lock.lock();
+            error = msg;
+            busy = false;
+            cv.notify_all();
+        }
+    }
+
+    thread worker;
+
+    mutex mtx;
+
+    condition_variable cv;
+
+    /** dump to be written, NULL if none */
+    CheckpointDump *job;
+
+    /** true while a dump is pending or being written */
+    bool busy;
+
+    /** true to stop the thread */
+    bool stop;
+
+    /** error message of the last writing */
+    string error;
+};
+
+#else
+
+/** without threads, dumps are always written on the calling thread */
+class CheckpointWriter {
+public:
+    bool isBusy() { return false; }
+    void submit(CheckpointDump *dump) { delete dump; }
+    string wait() { return ""; }
+};
+
+#endif
+
+void Checkpoint::setAsyncDump(bool async) {
+#ifndef _OPENMP
+    async = false;
+#endif
+    if (async == (writer != NULL))
+        return;
+    if (async)
+        writer = new CheckpointWriter;
+    else {
+        waitDump();
+        delete writer;
+        writer = NULL;
+    }
+}
+
+void Checkpoint::waitDump() {
+    if (!writer)
+        return;
+    string msg = writer->wait();
+    if (!msg.empty())
+        outError(msg);
+}
+
+void Checkpoint::setJournal(bool journal) {
+    this->journal = journal;
+    if (journal_base)
+        delete journal_base;
+    journal_base = NULL;
+}
+
+void Checkpoint::setBinaryArrays(bool binary) {
+    binary_arrays = binary;
+}
+
+/** @return number of bytes of an entry in the checkpoint file */
+static inline size_t entryBytes(const string &key, const string &value) {
+    return key.length() + value.length() + 3;
+}
+
+size_t Checkpoint::getJournalChanges(map<string, string> &changed, StrVector &deleted) {
+    size_t bytes = 0;
+    auto base = journal_base->begin();
+    for (auto it = begin(); it != end(); it++) {
+        while (base != journal_base->end() && base->first < it->first) {
+            deleted.push_back(base->first);
+            base++;
+        }
+        if (base != journal_base->end() && base->first == it->first) {
+            if (base->second != it->second)
+                changed.insert(changed.end(), *it);
+            base++;
+        } else
+            changed.insert(changed.end(), *it);
+    }
+    for (; base != journal_base->end(); base++)
+        deleted.push_back(base->first);
+    // bring journal_base up to date
+    for (auto key : deleted) {
+        auto it = journal_base->find(key);
+        journal_base_bytes -= entryBytes(key, it->second);
+        journal_base->erase(it);
+        bytes += key.length() + 2;
+    }
+    for (auto it : changed) {
+        auto base_it = journal_base->find(it.first);
+        if (base_it != journal_base->end()) {
+            journal_base_bytes -= entryBytes(base_it->first, base_it->second);
+            base_it->second = it.second;
+        } else
+            journal_base->insert(it);
+        journal_base_bytes += entryBytes(it.first, it.second);
+        bytes += entryBytes(it.first, it.second);
+    }
+    return bytes;
+}
+
+void Checkpoint::dump(bool force) {
+    if (filename == "")
+        return;
+        
+    if (!force && getRealTime() < prev_dump_time + dump_interval) {
+        return;
+    }
+    if (writer) {
+        if (!force && writer->isBusy())
+            // try again at the next call
+            return;
+        waitDump();
+    }
+    prev_dump_time = getRealTime();
+    CheckpointDump *dump = new CheckpointDump;
+    dump->filename = filename;
+    dump->header = header;
+    dump->compression = compression;
+    dump->append = false;
     if (Params::getInstance().print_all_checkpoints) {
         // Feature request by Nick Goldman
         dump_count++;
-        filename_tmp = (string)Params::getInstance().out_prefix + "." + convertIntToString(dump_count) + ".ckp.gz";
-        try {
-            ostream *out;
-            if (compression)
-                out = new ogzstream(filename_tmp.c_str());
-            else
-                out = new ofstream(filename_tmp.c_str());
-            out->exceptions(ios::failbit | ios::badbit);
-            *out << header << endl;
-            // call dump stream
-            dump(*out);
-            if (compression)
-                ((ogzstream*)out)->close();
-            else
-                ((ofstream*)out)->close();
-            delete out;
-        } catch (ios::failure &) {
-            outError(ERR_WRITE_OUTPUT, filename_tmp.c_str());
+        dump->all_filename = (string)Params::getInstance().out_prefix + "." + convertIntToString(dump_count) + ".ckp.gz";
+    }
+    if (journal && dump->all_filename.empty() && journal_base && fileExists(filename)) {
+        journal_bytes += getJournalChanges(dump->entries, dump->deleted);
+        if (journal_bytes <= journal_base_bytes) {
+            dump->append = true;
+            if (dump->entries.empty() && dump->deleted.empty()) {
+                // nothing changed
+                delete dump;
+                return;
+            }
+        } else {
+            // compaction: rewrite the file when the journal becomes larger than the checkpoint
+            dump->entries.clear();
+            dump->deleted.clear();
         }
+    }
+    if (!dump->append) {
+        string filename_tmp = filename + ".tmp";
+        if (fileExists(filename_tmp)) {
+            outWarning("IQ-TREE was killed while writing temporary checkpoint file " + filename_tmp);
+            outWarning("You should increase checkpoint interval from the default 60 seconds");
+            outWarning("via -cptime option to avoid too frequent checkpoint for large datasets");
+        }
+        if (journal && dump->all_filename.empty()) {
+            if (!journal_base)
+                journal_base = new map<string, string>;
+            *journal_base = *this;
+            journal_base_bytes = 0;
+            for (auto it : *journal_base)
+                journal_base_bytes += entryBytes(it.first, it.second);
+            journal_bytes = 0;
+        }
+    }
+    if (writer) {
+        // only copying the entries blocks the caller
+        if (!dump->append)
+            dump->entries = *this;
+        writer->submit(dump);
+        if (force)
+            waitDump();
     } else {
+        try {
+            if (dump->append)
+                dump->write();
+            else {
+                writeCheckpointFile(*this, dump->filename, dump->header, dump->compression, true);
+                if (!dump->all_filename.empty())
+                    writeCheckpointFile(*this, dump->all_filename, dump->header, dump->compression, false);
+            }
+        } catch (string &str) {
+            outError(str);
+        }
+        delete dump;
+    }
+    if (!Params::getInstance().print_all_checkpoints) {
         // check that the dumping time is too long and increase dump_interval if necessary
         double dump_time = getRealTime() - prev_dump_time;
         if (dump_time*20 > dump_interval) {
@@ -19,6 +19,8 @@
 
 using namespace std;
 
+class CheckpointWriter;
+
 // several useful declaration to save to or restore from a checkpoint
 #define CKP_SAVE(var) checkpoint->put(#var, var)
 #define CKP_ARRAY_SAVE(num, arr) checkpoint->putArray(#arr, num, arr)
@@ -42,6 +44,23 @@ using namespace std;
 
 const char CKP_SEP = '!';
 
+/** prefix of an array of doubles stored as base64 of the IEEE 754 little-endian bytes */
+const char CKP_BINARY_PREFIX[] = "~b64 ";
+
+/**
+    @param value array of doubles
+    @param num number of elements
+    @return CKP_BINARY_PREFIX followed by the base64 encoding of the array
+*/
+string encodeCkpDoubles(const double *value, size_t num);
+
+/**
+    @param str string from encodeCkpDoubles()
+    @param[out] value decoded array
+    @return false if str is not a binary array
+*/
+bool decodeCkpDoubles(const string &str, vector<double> &value);
+
 /** checkpoint stream */
 class CkpStream : public stringstream {
 public:
@@ -73,6 +92,12 @@ public:
     /** destructor */
 	virtual ~Checkpoint();
 
+    /** copy entries and settings, but not the background writer */
+    Checkpoint(const Checkpoint &ckp);
+
+    /** copy entries and settings, but keep the own background writer */
+    Checkpoint &operator=(const Checkpoint &ckp);
+
 	/**
 	 * @param filename file name
 	 */
@@ -110,6 +135,13 @@ public:
 	 */
 	void dump(ostream &out);
 
+	/**
+	 * dump checkpoint entries into an output stream
+     * @param entries key-value entries, e.g. a snapshot of a checkpoint
+     * @param out output stream
+	 */
+	static void dump(const map<string, string> &entries, ostream &out);
+
 	/**
 	 * dump checkpoint information into file
 	 * @param force TRUE to dump no matter if time interval exceeded or not
@@ -122,6 +154,31 @@ public:
     */
     void setDumpInterval(double interval);
 
+    /**
+        write checkpoint files in a background thread: dump() only copies the entries
+        and the writer thread serializes, compresses and renames the file.
+        A dump is skipped if the previous one is still being written, unless forced.
+        @param async true to write in the background, false to write on the calling thread
+    */
+    void setAsyncDump(bool async);
+
+    /**
+        wait until the background writer has written the last dump
+    */
+    void waitDump();
+
+    /**
+        append only the entries changed since the previous dump to the checkpoint file,
+        the file is rewritten when the appended records exceed the size of the checkpoint
+        @param journal true to append changes, false to rewrite the file at every dump
+    */
+    void setJournal(bool journal);
+
+    /**
+        @param binary true to store arrays of doubles in binary (base64) instead of text
+    */
+    void setBinaryArrays(bool binary);
+
 	/**
 	 * @return true if checkpoint contains the key
 	 * @param key key to search for
@@ -203,6 +260,8 @@ public:
         iterator it = find(key);
         if (it == end())
             return false;
+        if (getBinaryArray(it->second, maxnum, value))
+            return true;
         size_t pos = 0, next_pos;
         for (int i = 0; i < maxnum; i++) {
         	next_pos = it->second.find(", ", pos);
@@ -234,6 +293,8 @@ public:
         iterator it = find(key);
         if (it == end())
             return false;
+        if (getBinaryVector(it->second, value))
+            return true;
         size_t pos = 0, next_pos;
         value.clear();
         for (int i = 0; ; i++) {
@@ -346,6 +407,8 @@ public:
             key = struct_name.substr(0, struct_name.length()-1);
         else
             key = struct_name + key;
+        if (binary_arrays && putBinaryArray((*this)[key], num, value))
+            return;
         CkpStream ss;
         ss.precision(10);
         for (int i = 0; i < num; i++) {
@@ -367,6 +430,8 @@ public:
             key = struct_name.substr(0, struct_name.length()-1);
         else
             key = struct_name + key;
+        if (binary_arrays && putBinaryArray((*this)[key], value.size(), value.data()))
+            return;
         CkpStream ss;
         ss.precision(10);
         for (int i = 0; i < value.size(); i++) {
@@ -459,9 +524,72 @@ protected:
     
     /** header line of checkpoint file */
     string header;
-    
+
+    /** background writer thread, NULL to write on the calling thread */
+    CheckpointWriter *writer;
+
+    /** true to append changed entries to the checkpoint file */
+    bool journal;
+
+    /** entries as in the checkpoint file, NULL if the file has to be rewritten */
+    map<string, string> *journal_base;
+
+    /** number of bytes of journal_base */
+    size_t journal_base_bytes;
+
+    /** number of bytes appended since the file was rewritten */
+    size_t journal_bytes;
+
+    /** true to store arrays of doubles in binary */
+    bool binary_arrays;
+
+    /**
+        compare the entries with journal_base and update journal_base
+        @param[out] changed new or changed entries
+        @param[out] deleted keys removed since the last dump
+        @return number of bytes of the changes
+    */
+    size_t getJournalChanges(map<string, string> &changed, StrVector &deleted);
+
 private:
 
+    /** text encoding for other types */
+    template<class T>
+    static bool putBinaryArray(string &str, size_t num, const T *value) {
+        return false;
+    }
+
+    static bool putBinaryArray(string &str, size_t num, const double *value) {
+        if (num == 0)
+            return false;
+        str = encodeCkpDoubles(value, num);
+        return true;
+    }
+
+    /** binary arrays are only written for doubles */
+    template<class T>
+    static bool getBinaryArray(const string &str, int maxnum, T *value) {
+        return false;
+    }
+
+    static bool getBinaryArray(const string &str, int maxnum, double *value) {
+        vector<double> vec;
+        if (!decodeCkpDoubles(str, vec))
+            return false;
+        ASSERT(vec.size() == maxnum);
+        std::copy(vec.begin(), vec.end(), value);
+        return true;
+    }
+
+    template<class T>
+    static bool getBinaryVector(const string &str, vector<T> &value) {
+        return false;
+    }
+
+    static bool getBinaryVector(const string &str, vector<double> &value) {
+        return decodeCkpDoubles(str, value);
+    }
+
     /** name of the current nested key */
     string struct_name;
 
@@ -47,9 +47,10 @@ void showBanner() {
 }
 
 void showUsage() {
-    std::cout << "\nUsage: DecentTree -in [mldist] -out [newick] -t [algorithm] (-gz) (-no-banner)\n";
+    std::cout << "\nUsage: DecentTree -in [mldist] -out [newick] -t [algorithm] (-gz) (-no-banner) (-mmap [dir])\n";
     std::cout << "[mldist] is the path of a distance matrix file (which may be in .gz format)\n";
     std::cout << "[newick] is the path to write the newick tree file to (if it ends in .gz it will be compressed)\n";
+    std::cout << "[dir] is a directory for temporary files backing the matrices (for inputs larger than memory)\n";
     std::cout << "[algorithm] is one of the following, supported, distance matrix algorithms:\n";
     std::cout << StartTree::Factory::getInstance().getListOfTreeBuilders();
 }
@@ -89,6 +90,10 @@ int main(int argc, char* argv[]) {
         else if (arg=="-no-banner") {
             isBannerSuppressed = true;
         }
+        else if (arg=="-mmap") {
+            StartTree::setMatrixFileDirectory(nextArg);
+            ++argNum;
+        }
         else {
             PROBLEM("Unrecognized command-line argument, " + arg);
             break;
@@ -49,14 +49,16 @@ gzstreambuf* gzstreambuf::open( const char* name, int open_mode, int compression
     if ( is_open())
         return (gzstreambuf*)0;
     mode = open_mode;
-    // no append nor read/write mode
-    if ((mode & std::ios::ate) || (mode & std::ios::app)
+    // no read/write mode, append only for writing: a new gzip member is added to the file
+    if ((mode & std::ios::ate) || ((mode & std::ios::app) && (mode & std::ios::in))
         || ((mode & std::ios::in) && (mode & std::ios::out)))
         return (gzstreambuf*)0;
     char  fmode[10];
     char* fmodeptr = fmode;
     if ( mode & std::ios::in)
         *fmodeptr++ = 'r';
+    else if ( mode & std::ios::app)
+        *fmodeptr++ = 'a';
     else if ( mode & std::ios::out)
         *fmodeptr++ = 'w';
     *fmodeptr++ = 'b';
@@ -956,6 +956,39 @@ double Optimization::derivativeFunk(double x[], double dfx[]) {
 		return INFINITIVE;
 	*/
 	int ndim = getNDim();
+	int num_workers = (ndim > 1) ? min(prepareGradientWorkers(), ndim) : 1;
+	for (int worker = 1; worker < num_workers; worker++)
+		if (getGradientWorker(worker)->getNDim() != ndim) {
+			num_workers = 1;
+			break;
+		}
+	if (num_workers > 1) {
+		// each worker takes every num_workers-th dimension and uses its own function
+		// value at x, as the copies may differ from this object in the last digits
+		double fx = 0.0;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_workers) schedule(static, 1)
+#endif
+		for (int worker = 0; worker < num_workers; worker++) {
+			Optimization *opt = getGradientWorker(worker);
+			double *y = new double[ndim+1];
+			copy(x, x+ndim+1, y);
+			double fy = opt->targetFunk(y);
+			if (worker == 0)
+				fx = fy;
+			for (int dim = worker+1; dim <= ndim; dim += num_workers) {
+				double temp = y[dim];
+				double h = ERROR_X * fabs(temp);
+				if (h == 0.0) h = ERROR_X;
+				y[dim] = temp + h;
+				h = y[dim] - temp;
+				dfx[dim] = (opt->targetFunk(y) - fy) / h;
+				y[dim] = temp;
+			}
+			delete [] y;
+		}
+		return fx;
+	}
 	double *h = new double[ndim+1];
     double temp;
     int dim;
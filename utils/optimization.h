@@ -144,6 +144,18 @@ public:
 	*/
 	virtual double derivativeFunk(double x[], double dfx[]);
 
+	/**
+		prepare the objects evaluating targetFunk() concurrently for derivativeFunk()
+		@return number of workers, 1 to evaluate the dimensions serially
+	*/
+	virtual int prepareGradientWorkers() { return 1; }
+
+	/**
+		@param worker worker ID, 0 <= worker < prepareGradientWorkers()
+		@return object evaluating targetFunk() for the worker, worker 0 is this object
+	*/
+	virtual Optimization *getGradientWorker(int worker) { return this; }
+
 	/**
 	        Controls restarting of optimization if optimization gets
                 stuck on the boundary. Models are free to override this
@@ -49,6 +49,11 @@ namespace StartTree
 
     class BenchmarkingTreeBuilder;
 
+    //Keep the matrices of subsequently constructed NJ, BIONJ and UPGMA
+    //trees in memory-mapped temporary files in directory (if it is
+    //empty, on the heap, which is the default).
+    void setMatrixFileDirectory(const std::string &directory);
+
     class Factory
     {
         friend class BenchmarkingTreeBuilder;
@@ -1111,6 +1111,7 @@ void parseArg(int argc, char *argv[], Params &params) {
 
     params.aln_file = NULL;
     params.phylip_sequential_format = false;
+    params.aln_cache = false;
     params.symtest = SYMTEST_NONE;
     params.symtest_only = false;
     params.symtest_remove = 0;
@@ -1305,6 +1306,8 @@ void parseArg(int argc, char *argv[], Params &params) {
 
     params.gbo_replicates = 0;
 	params.ufboot_epsilon = 0.5;
+	params.ufboot_batch = 1;
+	params.ufboot_compact = 0;
     params.check_gbo_sample_size = 0;
     params.use_rell_method = true;
     params.use_elw_method = false;
@@ -1360,6 +1363,7 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.numSupportTrees = 20;
 //    params.sprDist = 20;
     params.sprDist = 6;
+    params.parsInsertNbh = 0;
     params.sankoff_cost_file = NULL;
     params.numNNITrees = 20;
     params.avh_test = 0;
@@ -1370,6 +1374,7 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.num_threads = 1;
     params.num_threads_max = 10000;
     params.openmp_by_model = false;
+    params.openmp_by_grad = false;
     params.model_test_criterion = MTC_BIC;
 //    params.model_test_stop_rule = MTC_ALL;
     params.model_test_sample_size = 0;
@@ -1387,8 +1392,11 @@ void parseArg(int argc, char *argv[], Params &params) {
 	params.print_branch_lengths = false;
 	params.lh_mem_save = LM_PER_NODE; // auto detect
     params.buffer_mem_save = false;
+    params.lh_float = false;
+    params.analytic_gradient = true;
 	params.start_tree = STT_PLL_PARSIMONY;
     params.start_tree_subtype_name = StartTree::Factory::getNameOfDefaultTreeBuilder();
+    params.dist_mmap_dir = NULL;
 
     params.modelfinder_ml_tree = true;
     params.final_model_opt = true;
@@ -1413,6 +1421,8 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.checkpoint_dump_interval = 60;
     params.force_unfinished = false;
     params.print_all_checkpoints = false;
+    params.checkpoint_async = true;
+    params.checkpoint_journal = true;
     params.suppress_output_flags = 0;
     params.ufboot2corr = false;
     params.u2c_nni5 = false;
@@ -2380,6 +2390,10 @@ void parseArg(int argc, char *argv[], Params &params) {
                 params.phylip_sequential_format = true;
                 continue;
             }
+            if (strcmp(argv[cnt], "--aln-cache") == 0) {
+                params.aln_cache = true;
+                continue;
+            }
             if (strcmp(argv[cnt], "--symtest") == 0) {
                 params.symtest = SYMTEST_MAXDIV;
                 continue;
@@ -3076,6 +3090,14 @@ void parseArg(int argc, char *argv[], Params &params) {
 				continue;
 			}
 
+            if (strcmp(argv[cnt], "--dist-mmap") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --dist-mmap <directory>";
+                params.dist_mmap_dir = argv[cnt];
+                continue;
+            }
+
 			if (strcmp(argv[cnt], "-ao") == 0 || strcmp(argv[cnt], "--out-alignment") == 0 || strcmp(argv[cnt], "--out-aln") == 0) {
 				cnt++;
 				if (cnt >= argc)
@@ -4298,6 +4320,24 @@ void parseArg(int argc, char *argv[], Params &params) {
 					throw "Epsilon must be positive";
 				continue;
 			}
+			if (strcmp(argv[cnt], "--ufboot-batch") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use --ufboot-batch <num_trees>";
+				params.ufboot_batch = convert_int(argv[cnt]);
+				if (params.ufboot_batch < 1)
+					throw "Number of batched trees must be positive";
+				continue;
+			}
+			if (strcmp(argv[cnt], "--ufboot-compact") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use --ufboot-compact 8|16";
+				params.ufboot_compact = convert_int(argv[cnt]);
+				if (params.ufboot_compact != 8 && params.ufboot_compact != 16)
+					throw "--ufboot-compact must be 8 or 16";
+				continue;
+			}
 			if (strcmp(argv[cnt], "-wbt") == 0 || strcmp(argv[cnt], "--wbt") == 0 || strcmp(argv[cnt], "--boot-trees") == 0) {
 				params.print_ufboot_trees = 1;
 				continue;
@@ -4429,6 +4469,14 @@ void parseArg(int argc, char *argv[], Params &params) {
                 params.buffer_mem_save = false;
                 continue;
             }
+            if (strcmp(argv[cnt], "--lh-float") == 0) {
+                params.lh_float = true;
+                continue;
+            }
+            if (strcmp(argv[cnt], "--num-grad") == 0) {
+                params.analytic_gradient = false;
+                continue;
+            }
 //			if (strcmp(argv[cnt], "-storetrees") == 0) {
 //				params.store_candidate_trees = true;
 //				continue;
@@ -4896,6 +4944,11 @@ void parseArg(int argc, char *argv[], Params &params) {
                 continue;
             }
 
+            if (strcmp(argv[cnt], "--thread-grad") == 0) {
+                params.openmp_by_grad = true;
+                continue;
+            }
+
             if (strcmp(argv[cnt], "--thread-site") == 0) {
                 params.openmp_by_model = false;
                 continue;
@@ -4920,6 +4973,15 @@ void parseArg(int argc, char *argv[], Params &params) {
 				params.sprDist = convert_int(argv[cnt]);
 				continue;
 			}
+			if (strcmp(argv[cnt], "--pars-nbh") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use --pars-nbh <number of closest taxa for parsimony insertion>";
+				params.parsInsertNbh = convert_int(argv[cnt]);
+				if (params.parsInsertNbh < 0)
+					throw "--pars-nbh must be non-negative";
+				continue;
+			}
             
             if (strcmp(argv[cnt], "--mpcost") == 0) {
                 cnt++;
@@ -5322,6 +5384,16 @@ void parseArg(int argc, char *argv[], Params &params) {
                 params.print_all_checkpoints = true;
                 continue;
             }
+
+            if (strcmp(argv[cnt], "--sync-checkpoint") == 0) {
+                params.checkpoint_async = false;
+                continue;
+            }
+
+            if (strcmp(argv[cnt], "--no-cp-journal") == 0) {
+                params.checkpoint_journal = false;
+                continue;
+            }
             
 			if (strcmp(argv[cnt], "--no-log") == 0) {
 				params.suppress_output_flags |= OUT_LOG;
@@ -5980,27 +6052,34 @@ void usage_iqtree(char* argv[], bool full_command) {
     << "  -s FILE[,...,FILE]   PHYLIP/FASTA/NEXUS/CLUSTAL/MSF alignment file(s)" << endl
     << "  -s DIR               Directory of alignment files" << endl
     << "  --seqtype STRING     BIN, DNA, AA, NT2AA, CODON, MORPH (default: auto-detect)" << endl
+    << "  --aln-cache          Reuse parsed alignment from binary cache FILE.alncache" << endl
     << "  -t FILE|PARS|RAND    Starting tree (default: 99 parsimony and BIONJ)" << endl
+    << "  --dist-mmap DIR      Keep BIONJ/NJ matrices in memory-mapped files in DIR" << endl
     << "  -o TAX[,...,TAX]     Outgroup taxon (list) for writing .treefile" << endl
     << "  --prefix STRING      Prefix for all output files (default: aln/partition)" << endl
     << "  --seed NUM           Random seed number, normally used for debugging purpose" << endl
     << "  --safe               Safe likelihood kernel to avoid numerical underflow" << endl
     << "  --mem NUM[G|M|%]     Maximal RAM usage in GB | MB | %" << endl
+    << "  --lh-float           Store partial likelihoods in single precision to save RAM" << endl
     << "  --runs NUM           Number of indepedent runs (default: 1)" << endl
     << "  -v, --verbose        Verbose mode, printing more messages to screen" << endl
     << "  -V, --version        Display version number" << endl
     << "  --quiet              Quiet mode, suppress printing to screen (stdout)" << endl
     << "  -fconst f1,...,fN    Add constant patterns into alignment (N=no. states)" << endl
     << "  --epsilon NUM        Likelihood epsilon for parameter estimate (default 0.01)" << endl
+    << "  --num-grad           Numerical instead of analytic gradients for model params" << endl
 #ifdef _OPENMP
     << "  -T NUM|AUTO          No. cores/threads or AUTO-detect (default: 1)" << endl
     << "  --threads-max NUM    Max number of threads for -T AUTO (default: all cores)" << endl
+    << "  --thread-grad        Numerical gradients in parallel over model params" << endl
 #endif
     << endl << "CHECKPOINT:" << endl
     << "  --redo               Redo both ModelFinder and tree search" << endl
     << "  --redo-tree          Restore ModelFinder and only redo tree search" << endl
     << "  --undo               Revoke finished run, used when changing some options" << endl
     << "  --cptime NUM         Minimum checkpoint interval (default: 60 sec and adapt)" << endl
+    << "  --sync-checkpoint    Write checkpoint on the search thread, not in background" << endl
+    << "  --no-cp-journal      Rewrite whole checkpoint as text instead of appending changes" << endl
     << endl << "PARTITION MODEL:" << endl
     << "  -p FILE|DIR          NEXUS/RAxML partition file or directory with alignments" << endl
     << "                       Edge-linked proportional partition model" << endl
@@ -6022,6 +6101,7 @@ void usage_iqtree(char* argv[], bool full_command) {
     << "  --nstop NUM          Number of unsuccessful iterations to stop (default: 100)" << endl
     << "  --perturb NUM        Perturbation strength for randomized NNI (default: 0.5)" << endl
     << "  --radius NUM         Radius for parsimony SPR search (default: 6)" << endl
+    << "  --pars-nbh NUM       Insert parsimony taxa near NUM closest taxa (default: 0, all)" << endl
     << "  --allnni             Perform more thorough NNI search (default: OFF)" << endl
     << "  -g FILE              (Multifurcating) topological constraint tree file" << endl
     << "  --fast               Fast search to resemble FastTree" << endl
@@ -6046,6 +6126,8 @@ void usage_iqtree(char* argv[], bool full_command) {
     << "  --nstep NUM          Iterations for UFBoot stopping rule (default: 100)" << endl
     << "  --bcor NUM           Minimum correlation coefficient (default: 0.99)" << endl
     << "  --beps NUM           RELL epsilon to break tie (default: 0.5)" << endl
+    << "  --ufboot-batch NUM   Candidate trees evaluated together by RELL (default: 1)" << endl
+    << "  --ufboot-compact NUM Store UFBoot weights as 8 or 16-bit integers" << endl
     << "  --bnni               Optimize UFBoot trees by NNI on bootstrap alignment" << endl
     << endl << "NON-PARAMETRIC BOOTSTRAP/JACKKNIFE:" << endl
     << "  -b, --boot NUM       Replicates for bootstrap + ML tree + consensus tree" << endl
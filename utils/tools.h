@@ -730,6 +730,12 @@ public:
 	 */
 	int sprDist;
 
+	/**
+	 *  number of closest placed taxa around which a new taxon is inserted
+	 *  during stepwise addition of a parsimony tree, 0 to try all branches
+	 */
+	int parsInsertNbh;
+
     /** cost matrix file for Sankoff parsimony */
     char *sankoff_cost_file;
     
@@ -909,6 +915,9 @@ public:
     START_TREE_TYPE start_tree;
     std::string start_tree_subtype_name;
 
+    /** directory for memory-mapped temporary files holding the NJ/BIONJ matrices, NULL to keep them on the heap */
+    char *dist_mmap_dir;
+
     /** TRUE to infer fast ML tree for ModelFinder */
     bool modelfinder_ml_tree;
     
@@ -931,6 +940,9 @@ public:
     /** true if sequential phylip format is used, default: false (interleaved format) */
     bool phylip_sequential_format;
 
+    /** true to load the parsed alignment from the binary cache <alignment>.alncache, written if missing or outdated */
+    bool aln_cache;
+
     /**
      SYMTEST_NONE to not perform test of symmetry of Jermiin et al. (default)
      SYMTEST_MAXDIV to perform symmetry test on the pair with maximum divergence
@@ -2197,6 +2209,17 @@ public:
 	 */
 	double ufboot_epsilon;
 
+	/**
+	 * number of candidate trees buffered and evaluated together on all UFBoot samples,
+	 * 1 to evaluate each tree immediately
+	 */
+	int ufboot_batch;
+
+	/**
+	 * number of bits (8 or 16) to store UFBoot pattern weights as integers, 0 to store them as BootValType
+	 */
+	int ufboot_compact;
+
     /**
             TRUE to check with different max_candidate_trees
      */
@@ -2330,6 +2353,9 @@ public:
     /** true to parallel ModelFinder by models instead of sites */
     bool openmp_by_model;
 
+    /** true to evaluate finite-difference gradients in parallel over parameters instead of sites */
+    bool openmp_by_grad;
+
     /** either MTC_AIC, MTC_AICc, MTC_BIC */
     ModelTestCriterion model_test_criterion;
 
@@ -2388,6 +2414,12 @@ public:
     /** true to save buffer, default: false */
     bool buffer_mem_save;
 
+    /** true to store partial likelihood vectors in single precision, default: false */
+    bool lh_float;
+
+    /** true to use analytic gradients when optimizing model parameters, false for finite differences */
+    bool analytic_gradient;
+
     /** maximum size of memory allowed to use */
     double max_mem_size;
 
@@ -2439,6 +2471,12 @@ public:
     /** TRUE to print checkpoints to 1.ckp.gz, 2.ckp.gz,... */
     bool print_all_checkpoints;
 
+    /** TRUE (default) to write checkpoint files in a background thread */
+    bool checkpoint_async;
+
+    /** TRUE (default) to append changed checkpoint entries and store arrays of doubles in binary */
+    bool checkpoint_journal;
+
     /** control output files to be written
      * OUT_LOG
      * OUT_TREEFILE